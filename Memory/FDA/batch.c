@@ -0,0 +1,476 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pgmfiles.h"
+#include "diff2d.h"
+#include "batch.h"
+
+#define QUEUE_SIZE 8        /* images waiting between two stages */
+
+
+/*--------------------------------------------------------------------------*/
+/*                       bounded queue between stages                       */
+/*--------------------------------------------------------------------------*/
+
+typedef struct fdaJob {
+  eightBitPGMImage *image;   /* image read by the decode stage */
+  float **matrix;            /* its samples, filtered in place */
+  char outName[255];         /* where the encode stage writes it */
+} fdaJob;
+
+typedef struct fdaQueue {
+  fdaJob *jobs[QUEUE_SIZE];
+  int head, count;
+  int producers;             /* stages still pushing; 0 means closed */
+  pthread_mutex_t mutex;
+  pthread_cond_t notEmpty, notFull;
+} fdaQueue;
+
+static void queueInit(fdaQueue *q, int producers)
+{
+  q->head = q->count = 0;
+  q->producers = producers;
+  pthread_mutex_init(&q->mutex, NULL);
+  pthread_cond_init(&q->notEmpty, NULL);
+  pthread_cond_init(&q->notFull, NULL);
+}
+
+static void queueDestroy(fdaQueue *q)
+{
+  pthread_mutex_destroy(&q->mutex);
+  pthread_cond_destroy(&q->notEmpty);
+  pthread_cond_destroy(&q->notFull);
+}
+
+/* blocks while the queue is full, so a fast stage can't run ahead */
+
+static void queuePush(fdaQueue *q, fdaJob *job)
+{
+  pthread_mutex_lock(&q->mutex);
+  while (q->count == QUEUE_SIZE)
+    pthread_cond_wait(&q->notFull, &q->mutex);
+  q->jobs[(q->head + q->count) % QUEUE_SIZE] = job;
+  q->count++;
+  pthread_mutex_unlock(&q->mutex);
+  pthread_cond_signal(&q->notEmpty);
+}
+
+/* NULL once every producer is done and the queue is drained */
+
+static fdaJob *queuePop(fdaQueue *q)
+{
+  fdaJob *job = NULL;
+
+  pthread_mutex_lock(&q->mutex);
+  while (q->count == 0 && q->producers > 0)
+    pthread_cond_wait(&q->notEmpty, &q->mutex);
+  if (q->count > 0)
+    {
+      job = q->jobs[q->head];
+      q->head = (q->head + 1) % QUEUE_SIZE;
+      q->count--;
+    }
+  pthread_mutex_unlock(&q->mutex);
+  pthread_cond_signal(&q->notFull);
+  return(job);
+}
+
+static void queueProducerDone(fdaQueue *q)
+{
+  pthread_mutex_lock(&q->mutex);
+  q->producers--;
+  pthread_mutex_unlock(&q->mutex);
+  pthread_cond_broadcast(&q->notEmpty);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                               input listing                              */
+/*--------------------------------------------------------------------------*/
+
+static int isPGMName(const struct dirent *entry)
+{
+  size_t len = strlen(entry->d_name);
+
+  return (len > 4 && (strcmp(entry->d_name + len - 4, ".pgm") == 0 ||
+                      strcmp(entry->d_name + len - 4, ".pnm") == 0));
+}
+
+/* frees the first n names and the list */
+
+static void freeNames(char **names, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    free(names[i]);
+  free(names);
+}
+
+/* names of the images to process, NULL terminated; NULL on error, with
+   *error set to PGMFileOpenError or PGMMemoryExausted */
+
+static char **listInput(const char *input, long *error)
+{
+  struct stat st;
+  char **names = NULL, **more;
+  char line[1024];
+  int n = 0, size = 0;
+  FILE *list;
+
+  *error = PGMFileOpenError;
+  if (stat(input, &st) < 0) return(NULL);
+
+  if (S_ISDIR(st.st_mode))
+    {
+      struct dirent **entries;
+      int count, i;
+
+      if ((count = scandir(input, &entries, isPGMName, alphasort)) < 0) return(NULL);
+      names = (char **) malloc((count + 1) * sizeof(char *));
+      for (i = 0; i < count; i++)
+        {
+          if (names != NULL)
+            {
+              if ((names[n] = (char *) malloc(strlen(input) + strlen(entries[i]->d_name) + 2)) == NULL)
+                {
+                  freeNames(names, n);
+                  names = NULL;
+                }
+              else
+                sprintf(names[n++], "%s/%s", input, entries[i]->d_name);
+            }
+          free(entries[i]);
+        }
+      free(entries);
+      if (names == NULL)
+        {
+          *error = PGMMemoryExausted;
+          return(NULL);
+        }
+      names[n] = NULL;
+      return(names);
+    }
+
+  if ((list = fopen(input, "r")) == NULL) return(NULL);
+  *error = PGMMemoryExausted;
+  while (fgets(line, sizeof(line), list) != NULL)
+    {
+      line[strcspn(line, "\r\n")] = '\0';
+      if (line[0] == '\0' || line[0] == '#') continue;
+      if (n + 1 >= size)
+        {
+          size = size ? 2 * size : 64;
+          if ((more = (char **) realloc(names, size * sizeof(char *))) == NULL) break;
+          names = more;
+        }
+      if ((names[n] = strdup(line)) == NULL) break;
+      n++;
+    }
+  if (!feof(list) || (names == NULL && (names = (char **) malloc(sizeof(char *))) == NULL))
+    {
+      if (ferror(list)) *error = PGMFileOpenError;
+      fclose(list);
+      freeNames(names, n);
+      return(NULL);
+    }
+  fclose(list);
+  names[n] = NULL;
+  return(names);
+}
+
+/* the outputs are named after the base names of the inputs: two inputs
+   with the same base name would overwrite each other's result */
+
+static const char *baseName(const char *name)
+{
+  return(strrchr(name, '/') ? strrchr(name, '/') + 1 : name);
+}
+
+static int compareBaseNames(const void *a, const void *b)
+{
+  return(strcmp(baseName(*(char * const *) a), baseName(*(char * const *) b)));
+}
+
+static int sameOutputNames(char **names)
+{
+  char **sorted;
+  int n, i, clash = 0;
+
+  for (n = 0; names[n] != NULL; n++)
+    ;
+  if ((sorted = (char **) malloc((n + 1) * sizeof(char *))) == NULL) return(PGMMemoryExausted);
+  memcpy(sorted, names, n * sizeof(char *));
+  qsort(sorted, n, sizeof(char *), compareBaseNames);
+  for (i = 1; i < n; i++)
+    if (compareBaseNames(&sorted[i - 1], &sorted[i]) == 0)
+      {
+        printf("%s and %s: same output name %s\n", sorted[i - 1], sorted[i], baseName(sorted[i]));
+        clash = 1;
+      }
+  free(sorted);
+  return(clash);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                                  stages                                  */
+/*--------------------------------------------------------------------------*/
+
+typedef struct fdaBatchStateStruct {
+  char **names;
+  const char *outDir;
+  float lambda;
+  long imax;
+  float tol;
+  fdaQueue decoded, diffused;
+  pthread_mutex_t mutex;
+  int failed;
+  int cancelled;             /* a stage couldn't start: drop the remaining images */
+} fdaBatchState;
+
+static int batchCancelled(fdaBatchState *b)
+{
+  int cancelled;
+
+  pthread_mutex_lock(&b->mutex);
+  cancelled = b->cancelled;
+  pthread_mutex_unlock(&b->mutex);
+  return(cancelled);
+}
+
+static void freeJob(fdaJob *job)
+{
+  freeMatrix(job->matrix, job->image->x);
+  freePGM(job->image);
+  free(job->image);
+  free(job);
+}
+
+static void batchFailed(fdaBatchState *b, const char *name, long error)
+{
+  pthread_mutex_lock(&b->mutex);
+  printf("%s: ", name);
+  if (error < 0) printPGMFileError(error); else printf("not enough storage available");
+  printf("\n");
+  b->failed++;
+  pthread_mutex_unlock(&b->mutex);
+}
+
+static void *decodeStage(void *arg)
+{
+  fdaBatchState *b = (fdaBatchState *) arg;
+  char **name;
+  const char *base;
+  long result;
+
+  for (name = b->names; *name != NULL && !batchCancelled(b); name++)
+    {
+      fdaJob *job = (fdaJob *) malloc(sizeof(fdaJob));
+
+      if (job == NULL || (job->image = (eightBitPGMImage *) malloc(sizeof(eightBitPGMImage))) == NULL)
+        {
+          batchFailed(b, *name, PGMMemoryExausted);
+          free(job);
+          continue;
+        }
+      base = baseName(*name);
+      if (strlen(*name) >= sizeof(job->image->fileName) ||
+          strlen(b->outDir) + strlen(base) + 2 > sizeof(job->outName))
+        result = PGMFileOpenError;
+      else
+        {
+          strcpy(job->image->fileName, *name);
+          sprintf(job->outName, "%s/%s", b->outDir, base);
+          result = readPGM(job->image);
+        }
+
+      if (result < 0 || (job->matrix = PGMToMatrix(job->image)) == NULL)
+        {
+          batchFailed(b, *name, result);
+          if (result >= 0) freePGM(job->image);
+          free(job->image);
+          free(job);
+          continue;
+        }
+
+      queuePush(&b->decoded, job);
+    }
+
+  queueProducerDone(&b->decoded);
+  return(NULL);
+}
+
+static void *diffuseStage(void *arg)
+{
+  fdaBatchState *b = (fdaBatchState *) arg;
+  fdaJob *job;
+  long i;
+  double l2;
+
+  /* the pool already keeps every CPU busy, one image per worker */
+
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+
+  while ((job = queuePop(&b->decoded)) != NULL)
+    {
+      if (batchCancelled(b))
+        {
+          freeJob(job);
+          continue;
+        }
+      for (i = 1; i <= b->imax; i++)
+        if (b->tol <= 0)
+          diff2d(0.5, b->lambda, job->image->x, job->image->y, job->matrix);
+        else
+          {
+            diff2dResidual(0.5, b->lambda, job->image->x, job->image->y, job->matrix, &l2, NULL);
+            if (l2 < b->tol) break;
+          }
+      queuePush(&b->diffused, job);
+    }
+
+  queueProducerDone(&b->diffused);
+  return(NULL);
+}
+
+static void *encodeStage(void *arg)
+{
+  fdaBatchState *b = (fdaBatchState *) arg;
+  fdaJob *job;
+  long result;
+
+  while ((job = queuePop(&b->diffused)) != NULL)
+    {
+      matrixToPGM(job->matrix, job->image);
+      freeMatrix(job->matrix, job->image->x);
+      strcpy(job->image->fileName, job->outName);
+      if ((result = write8bitPGM(job->image)) < 0)
+        batchFailed(b, job->outName, result);
+      else
+        printf("%s\n", job->outName);
+      freePGM(job->image);
+      free(job->image);
+      free(job);
+    }
+
+  return(NULL);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+int fdaBatch(const char *input, const char *outDir, float lambda, long imax, float tol, int threads)
+{
+  fdaBatchState b;
+  pthread_t decoder, encoder, *workers;
+  fdaJob *job;
+  char **name;
+  long error;
+  int i, decoding, diffusing, encoding;
+
+  if ((b.names = listInput(input, &error)) == NULL)
+    {
+      if (error == PGMMemoryExausted)
+        {
+          printf("%s: ", input);
+          printPGMFileError(error);
+          printf("\n");
+        }
+      else
+        printf("%s: cannot list input images\n", input);
+      return(-1);
+    }
+  if ((error = sameOutputNames(b.names)) != 0)
+    {
+      if (error < 0)
+        {
+          printf("%s: ", input);
+          printPGMFileError(error);
+          printf("\n");
+        }
+      for (name = b.names; *name != NULL; name++)
+        free(*name);
+      free(b.names);
+      return(-1);
+    }
+
+  if (threads <= 0)
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads <= 0)
+    threads = 1;
+
+  b.outDir = outDir;
+  b.lambda = lambda;
+  b.imax = imax;
+  b.tol = tol;
+  b.failed = 0;
+  b.cancelled = 0;
+
+  if ((workers = (pthread_t *) malloc(threads * sizeof(pthread_t))) == NULL)
+    {
+      printf("%s: ", input);
+      printPGMFileError(PGMMemoryExausted);
+      printf("\n");
+      for (name = b.names; *name != NULL; name++)
+        free(*name);
+      free(b.names);
+      return(-1);
+    }
+
+  queueInit(&b.decoded, 1);
+  queueInit(&b.diffused, threads);
+  pthread_mutex_init(&b.mutex, NULL);
+
+  decoding = pthread_create(&decoder, NULL, decodeStage, &b) == 0;
+  for (diffusing = 0; decoding && diffusing < threads; diffusing++)
+    if (pthread_create(&workers[diffusing], NULL, diffuseStage, &b) != 0)
+      break;
+  encoding = diffusing == threads && pthread_create(&encoder, NULL, encodeStage, &b) == 0;
+
+  /* a stage didn't start: stop the others, doing the work of the
+     missing consumers here so no stage waits on a full queue forever */
+
+  if (!encoding)
+    {
+      printf("%s: cannot start the batch threads\n", input);
+      pthread_mutex_lock(&b.mutex);
+      b.cancelled = 1;
+      pthread_mutex_unlock(&b.mutex);
+      if (!decoding)
+        queueProducerDone(&b.decoded);
+      for (i = diffusing; i < threads; i++)
+        queueProducerDone(&b.diffused);
+      if (diffusing == 0)
+        while ((job = queuePop(&b.decoded)) != NULL)
+          freeJob(job);
+      while ((job = queuePop(&b.diffused)) != NULL)
+        freeJob(job);
+    }
+
+  if (decoding)
+    pthread_join(decoder, NULL);
+  for (i = 0; i < diffusing; i++)
+    pthread_join(workers[i], NULL);
+  if (encoding)
+    pthread_join(encoder, NULL);
+
+  free(workers);
+  queueDestroy(&b.decoded);
+  queueDestroy(&b.diffused);
+  pthread_mutex_destroy(&b.mutex);
+  for (name = b.names; *name != NULL; name++)
+    free(*name);
+  free(b.names);
+
+  return(encoding ? b.failed : -1);
+}
@@ -0,0 +1,23 @@
+
+#ifndef FDA_BATCH
+#define FDA_BATCH
+
+/* Non interactive processing of many images. The work is split in three
+   stages connected by bounded queues:
+
+     decode (1 thread) -> diffuse (threads workers) -> encode (1 thread)
+
+   so reading and writing the files overlaps with the filtering.
+   Returns the number of images that failed, or -1 when the batch
+   couldn't run: no input, two inputs with the same base name (their
+   results would overwrite each other), or threads that didn't start. */
+
+int fdaBatch
+     (const char *input,    /* directory of .pgm/.pnm files or a list file, one name per line */
+      const char *outDir,   /* directory the results are written to, same base names */
+      float    lambda,      /* contrast parameter */
+      long     imax,        /* number of iterations */
+      float    tol,         /* stop once the RMS change is below tol, 0 to always run imax */
+      int      threads);    /* diffusion workers, <= 0 for one per online CPU */
+
+#endif
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <omp.h>
+#include "pgmfiles.h"
+#include "diff2d.h"
+#include "stencil.h"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+//gcc -O2 -o fdabench bench.c pgmfiles.c diff2d.c stencil.c -fopenmp -lm
+
+/* usage: fdabench [-s sizes] [-n iterations] [-t threads] [-r repeats]
+                   [-l lambda] [-P] [-d dir] [-o jsonfile]
+
+   Runs diff2d as main.c does on square synthetic images of the given
+   sizes (comma separated, default 512,1024,2048) with each of the given
+   thread counts (default 1), and writes the per phase timings as JSON to
+   jsonfile (default stdout). Each phase is the fastest of the repeats.
+
+   load      readPGM of the image, written to dir (default /tmp) first
+   convert   PGMToMatrix
+   allocate  malloc/free of the work copy in the iterations
+   pad       copy into the work copy, with the dummy boundaries
+   compute   the stencil
+   store     matrixToPGM and write8bitPGM
+
+   GB/s (over pad + compute) and GFLOP/s (over compute) come from a
+   nominal model per pixel and iteration: 16 bytes (the image read and the
+   work copy written by pad, the work copy read and the image written by
+   compute) and DIFF2D_FLOPS operations, pow and exp counting as one.
+   -P adds cycles, instructions, cache references and misses of the
+   iterations from perf_event_open (Linux, if perf_event_paranoid allows). */
+
+#define DIFF2D_FLOPS 113   /* per pixel: 8 x (dco 6 + weight 5), qC 8, average 17 */
+#define DIFF2D_BYTES 16
+
+#define PHASES 6
+
+static const char *phaseName[PHASES] = { "load", "convert", "allocate", "pad", "compute", "store" };
+
+
+/*--------------------------------------------------------------------------*/
+/*                          hardware counters                               */
+/*--------------------------------------------------------------------------*/
+
+#define COUNTERS 4
+
+static const char *counterName[COUNTERS] = { "cycles", "instructions", "cache_references", "cache_misses" };
+
+static int counterFd[COUNTERS] = { -1, -1, -1, -1 };
+
+/* Counters are opened with inherit before the first parallel region, so
+   they follow the OpenMP threads created afterwards. */
+
+static int openCounters(void)
+{
+#ifdef __linux__
+  static const unsigned long long config[COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES };
+  struct perf_event_attr attr;
+  int k;
+
+  for (k = 0; k < COUNTERS; k++)
+    {
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = config[k];
+      attr.disabled = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      if ((counterFd[k] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0)) < 0)
+        {
+          while (k-- > 0)
+            close(counterFd[k]);
+          counterFd[0] = -1;
+          return(-1);
+        }
+    }
+  return(0);
+#else
+  return(-1);
+#endif
+}
+
+static void enableCounters(int on)
+{
+#ifdef __linux__
+  int k;
+
+  for (k = 0; k < COUNTERS && counterFd[0] >= 0; k++)
+    {
+      if (on) ioctl(counterFd[k], PERF_EVENT_IOC_RESET, 0);
+      ioctl(counterFd[k], on ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+}
+
+static void readCounters(unsigned long long *value)
+{
+  int k;
+
+  for (k = 0; k < COUNTERS; k++)
+    if (counterFd[0] < 0 || read(counterFd[k], &value[k], sizeof(value[k])) != sizeof(value[k]))
+      value[k] = 0;
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+/* ---- a size x size P5 image: shaded disc on a ramp, with noise ---- */
+
+static long int writeSynthetic(const char *name, long size)
+{
+  eightBitPGMImage image;
+  long int i, j, result, di, dj;
+  unsigned int seed = 1;
+
+  memset(&image, 0, sizeof(image));
+  snprintf(image.fileName, sizeof(image.fileName), "%s", name);
+  image.x = image.y = size;
+  image.max = 255;
+  image.bytesPerSample = 1;
+  if ((image.imageData = (unsigned char *) malloc(size * size)) == NULL) return(PGMMemoryExausted);
+
+  for (i = 0; i < size; i++)
+    for (j = 0; j < size; j++)
+      {
+        di = i - size / 2;
+        dj = j - size / 2;
+        seed = seed * 1103515245 + 12345;
+        image.imageData[i * size + j] = (di * di + dj * dj < size * size / 9 ? 180 : 40 + 60 * j / size)
+                                        + (seed >> 16) % 32;
+      }
+
+  result = write8bitPGM(&image);
+  free(image.imageData);
+  return(result);
+}
+
+/* ---- one run of load, convert, iterations and store: seconds of the phases in t ---- */
+
+static long int runOnce(const char *inName, const char *outName, float lambda, long imax,
+                        double *t, unsigned long long *counters)
+{
+  eightBitPGMImage image;
+  stencilTimes times;
+  struct timespec clock;
+  float **matrix;
+  long int i, result;
+
+  memset(&image, 0, sizeof(image));
+  memset(&times, 0, sizeof(times));
+  snprintf(image.fileName, sizeof(image.fileName), "%s", inName);
+
+  clock_gettime(CLOCK_MONOTONIC, &clock);
+  if ((result = readPGM(&image)) < 0) return(result);
+  t[0] = stencilLap(&clock);
+  if ((matrix = PGMToMatrix(&image)) == NULL)
+    {
+      freePGM(&image);
+      return(PGMMemoryExausted);
+    }
+  t[1] = stencilLap(&clock);
+
+  stencilProfile = &times;
+  enableCounters(1);
+  for (i = 0; i < imax; i++)
+    diff2d(0.5, lambda, image.x, image.y, matrix);
+  enableCounters(0);
+  stencilProfile = NULL;
+  readCounters(counters);
+  t[2] = times.allocate;
+  t[3] = times.pad;
+  t[4] = times.compute;
+
+  stencilLap(&clock);
+  matrixToPGM(matrix, &image);
+  snprintf(image.fileName, sizeof(image.fileName), "%s", outName);
+  result = write8bitPGM(&image);
+  t[5] = stencilLap(&clock);
+
+  freeMatrix(matrix, image.x);
+  freePGM(&image);
+  return(result);
+}
+
+/* ---- comma separated list of positive numbers, at most max of them ---- */
+
+static int parseList(const char *text, long *list, int max)
+{
+  int n = 0;
+  char *end;
+
+  while (n < max && *text)
+    {
+      if ((list[n] = strtol(text, &end, 10)) <= 0 || end == text) return(0);
+      n++;
+      text = *end == ',' ? end + 1 : end;
+    }
+  return(n);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+int main(int argc, char **argv)
+{
+  long   sizes[16] = { 512, 1024, 2048 }, threads[16] = { 1 };
+  int    nSizes = 3, nThreads = 1, repeats = 3, perf = 0;
+  long   imax = 10;
+  float  lambda = 10;
+  char   *dir = "/tmp", *jsonName = NULL;
+  char   inName[255], outName[255];
+  double t[PHASES], best[PHASES], pixels, stencil;
+  unsigned long long counters[COUNTERS], bestCounters[COUNTERS];
+  FILE   *json = stdout;
+  int    opt, s, th, r, k, first = 1;
+  long   result;
+
+  while ((opt = getopt(argc, argv, "s:n:t:r:l:Pd:o:")) != -1)
+    switch (opt)
+      {
+      case 's': nSizes = parseList(optarg, sizes, 16); break;
+      case 't': nThreads = parseList(optarg, threads, 16); break;
+      case 'n': imax = atol(optarg); break;
+      case 'r': repeats = atoi(optarg); break;
+      case 'l': lambda = atof(optarg); break;
+      case 'P': perf = 1; break;
+      case 'd': dir = optarg; break;
+      case 'o': jsonName = optarg; break;
+      default:
+        nSizes = 0;
+      }
+  if (nSizes == 0 || nThreads == 0 || imax < 1 || repeats < 1 || lambda <= 0)
+    {
+      printf("usage: %s [-s sizes] [-n iterations] [-t threads] [-r repeats]\n"
+             "          [-l lambda] [-P] [-d dir] [-o jsonfile]\n", argv[0]);
+      return(1);
+    }
+
+  if (perf && openCounters() < 0)
+    {
+      fprintf(stderr, "perf_event_open not available, no counters\n");
+      perf = 0;
+    }
+  if (jsonName && (json = fopen(jsonName, "w")) == NULL)
+    {
+      printf("cannot open %s\n", jsonName);
+      return(1);
+    }
+
+  snprintf(inName, sizeof(inName), "%s/fdabench-%d-in.pgm", dir, (int) getpid());
+  snprintf(outName, sizeof(outName), "%s/fdabench-%d-out.pgm", dir, (int) getpid());
+
+  fprintf(json, "{\n  \"benchmark\": \"diff2d\",\n  \"lambda\": %g,\n  \"iterations\": %ld,\n"
+          "  \"repeats\": %d,\n  \"runs\": [", lambda, imax, repeats);
+
+  for (s = 0; s < nSizes; s++)
+    {
+      if ((result = writeSynthetic(inName, sizes[s])) < 0)
+        {
+          printPGMFileError(result);
+          printf("\n");
+          return(1);
+        }
+      pixels = (double) sizes[s] * sizes[s];
+
+      for (th = 0; th < nThreads; th++)
+        {
+          omp_set_num_threads(threads[th]);
+          for (k = 0; k < PHASES; k++)
+            best[k] = 1e300;
+          memset(bestCounters, 0, sizeof(bestCounters));
+
+          for (r = 0; r < repeats; r++)
+            {
+              if ((result = runOnce(inName, outName, lambda, imax, t, counters)) < 0)
+                {
+                  printPGMFileError(result);
+                  printf("\n");
+                  return(1);
+                }
+              for (k = 0; k < PHASES; k++)
+                if (t[k] < best[k]) best[k] = t[k];
+              if (r == 0 || counters[0] < bestCounters[0])
+                memcpy(bestCounters, counters, sizeof(counters));
+            }
+
+          stencil = best[3] + best[4];
+          fprintf(json, "%s\n    { \"size\": %ld, \"threads\": %ld,\n      \"seconds\": {",
+                  first ? "" : ",", sizes[s], threads[th]);
+          for (k = 0; k < PHASES; k++)
+            fprintf(json, "%s \"%s\": %.6f", k ? "," : "", phaseName[k], best[k]);
+          fprintf(json, " },\n      \"gbytes_per_s\": %.3f, \"gflops\": %.3f",
+                  DIFF2D_BYTES * pixels * imax / stencil / 1e9,
+                  DIFF2D_FLOPS * pixels * imax / best[4] / 1e9);
+          if (perf)
+            {
+              fprintf(json, ",\n      \"perf\": {");
+              for (k = 0; k < COUNTERS; k++)
+                fprintf(json, "%s \"%s\": %llu", k ? "," : "", counterName[k], bestCounters[k]);
+              fprintf(json, ", \"ipc\": %.3f }",
+                      bestCounters[0] ? (double) bestCounters[1] / bestCounters[0] : 0.0);
+            }
+          fprintf(json, " }");
+          fflush(json);
+          first = 0;
+
+          fprintf(stderr, "size %5ld threads %2ld: compute %.3f s, %.2f GFLOP/s\n",
+                  sizes[s], threads[th], best[4], DIFF2D_FLOPS * pixels * imax / best[4] / 1e9);
+        }
+    }
+
+  fprintf(json, "\n  ]\n}\n");
+  if (json != stdout)
+    fclose(json);
+  unlink(inName);
+  unlink(outName);
+  return(0);
+}
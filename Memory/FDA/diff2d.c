@@ -3,6 +3,7 @@
 #include <string.h>
 #include <math.h>
 #include "diff2d.h"
+#include "stencil.h"
 
 
 /*--------------------------------------------------------------------------*/
@@ -33,13 +34,66 @@ float dco (float v,         /* value at one point */
 /*--------------------------------------------------------------------------*/
 
 
-void diff2d
+void diff2dRow
+
+     (float    ht,        /* time step size, >0, e.g. 0.5 */
+      float    lambda,    /* contrast parameter */
+      long     ny,        /* image dimension in y direction */
+      float    *gm,       /* row i-1 of the work copy, with dummy boundaries */
+      float    *g0,       /* row i */
+      float    *gp,       /* row i+1 */
+      float    *f)        /* output: row i of the smoothed image, ny values */
+
+/* One row of the 9-point stencil of diff2d. Rows have ny+2 entries,   */
+/* entries 0 and ny+1 being the dummy boundaries; f gets entries 1..ny. */
+
+{
+
+long    j;                                        /* loop variable */
+float   qC, qN, qNE, qE, qSE, qS, qSW, qW, qNW;   /* weights */
+
+for (j=1; j<=ny; j++)
+
+     {
+
+       /* calculate weights */
+
+       qN  = (1.0 - exp(-8.0 * ht * dco(g0[j], g0[j+1], lambda))) / 8.0;
+       qNE = (1.0 - exp(-8.0 * ht * dco(g0[j], gp[j+1], lambda))) / 8.0;
+       qE  = (1.0 - exp(-8.0 * ht * dco(g0[j], gp[j  ], lambda))) / 8.0;
+       qSE = (1.0 - exp(-8.0 * ht * dco(g0[j], gp[j-1], lambda))) / 8.0;
+       qS  = (1.0 - exp(-8.0 * ht * dco(g0[j], g0[j-1], lambda))) / 8.0;
+       qSW = (1.0 - exp(-8.0 * ht * dco(g0[j], gm[j-1], lambda))) / 8.0;
+       qW  = (1.0 - exp(-8.0 * ht * dco(g0[j], gm[j  ], lambda))) / 8.0;
+       qNW = (1.0 - exp(-8.0 * ht * dco(g0[j], gm[j+1], lambda))) / 8.0;
+       qC  = 1.0 - qN - qNE - qE - qSE - qS - qSW - qW - qNW;
+
+
+       /* weighted averaging */
+
+       f[j-1] = qNW * gm[j+1] + qN * g0[j+1] + qNE * gp[j+1] +
+                qW  * gm[j  ] + qC * g0[j  ] + qE  * gp[j  ] +
+                qSW * gm[j-1] + qS * g0[j-1] + qSE * gp[j-1];
+
+     }  /* for */
+
+return;
+
+} /* diff2dRow */
+
+
+/*--------------------------------------------------------------------------*/
+
+
+void diff2dResidual
 
      (float    ht,        /* time step size, >0, e.g. 0.5 */
       float    lambda,    /* contrast parameter */
       long     nx,        /* image dimension in x direction */
       long     ny,        /* image dimension in y direction */
-      float    **f)       /* input: original image ;  output: smoothed */
+      float    **f,       /* input: original image ;  output: smoothed */
+      double   *l2,       /* output: root mean square change, may be NULL */
+      double   *linf)     /* output: largest change, may be NULL */
 
 
 /*--------------------------------------------------------------------------*/
@@ -58,89 +112,35 @@ void diff2d
 
 {
 
-long    i, j;                                     /* loop variables */
-float   qC, qN, qNE, qE, qSE, qS, qSW, qW, qNW;   /* weights */
-float   **g;                                      /* work copy of f */
-
-
-/* ---- allocate storage for g ---- */
-
-g = (float **) malloc ((nx+2) * sizeof(float *));
-if (g == NULL)
-   {
-     printf("not enough storage available\n");
-     exit(1);
-   }
-for (i=0; i<=nx+1; i++)
-    {
-      g[i] = (float *) malloc ((ny+2) * sizeof(float));
-      if (g[i] == NULL)
-         {
-           printf("not enough storage available\n");
-           exit(1);
-         }
-    }
-
-
-/* ---- copy f into g ---- */
-
-for (i=1; i<=nx; i++)
- for (j=1; j<=ny; j++)
-     g[i][j] = f[i-1][j-1];
-
-
-/* ---- create dummy boundaries ---- */
-
-for (i=1; i<=nx; i++)
-    {
-     g[i][0]    = g[i][1];
-     g[i][ny+1] = g[i][ny];
-    }
-
-for (j=0; j<=ny+1; j++)
-    {
-     g[0][j]    = g[1][j];
-     g[nx+1][j] = g[nx][j];
-    }
-
-
-/* ---- diffusive averaging ---- */
-
-for (i=1; i<=nx; i++)
- for (j=1; j<=ny; j++)
+stencilParams p;                                  /* ht and lambda */
 
-     {
 
-       /* calculate weights */
+/* ---- work copy, dummy boundaries, threads and residual are done ---- */
+/* ---- by the stencil engine, diff2dRow is its row kernel          ---- */
 
-       qN  = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i  ][j+1], lambda))) / 8.0;
-       qNE = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i+1][j+1], lambda))) / 8.0;
-       qE  = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i+1][j  ], lambda))) / 8.0;
-       qSE = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i+1][j-1], lambda))) / 8.0;
-       qS  = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i  ][j-1], lambda))) / 8.0;
-       qSW = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i-1][j-1], lambda))) / 8.0;
-       qW  = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i-1][j  ], lambda))) / 8.0;
-       qNW = (1.0 - exp(-8.0 * ht * dco(g[i][j], g[i-1][j+1], lambda))) / 8.0;
-       qC  = 1.0 - qN - qNE - qE - qSE - qS - qSW - qW - qNW;
+p.ht = ht;
+p.lambda = lambda;
+stencilApply (stencilFind("weickert"), &p, nx, ny, f, l2, linf);
 
+return;
 
-       /* weighted averaging */
+} /* diff2dResidual */
 
-       f[i-1][j-1] = qNW * g[i-1][j+1] + qN * g[i][j+1] + qNE * g[i+1][j+1] +
-                     qW  * g[i-1][j  ] + qC * g[i][j  ] + qE  * g[i+1][j  ] +
-                     qSW * g[i-1][j-1] + qS * g[i][j-1] + qSE * g[i+1][j-1];
 
-     }  /* for */
+/*--------------------------------------------------------------------------*/
 
 
-/* ---- disallocate storage for g ---- */
+void diff2d
 
-for (i=0; i<=nx+1; i++)
-    free(g[i]);
-free(g);
+     (float    ht,        /* time step size, >0, e.g. 0.5 */
+      float    lambda,    /* contrast parameter */
+      long     nx,        /* image dimension in x direction */
+      long     ny,        /* image dimension in y direction */
+      float    **f)       /* input: original image ;  output: smoothed */
 
+{
+diff2dResidual (ht, lambda, nx, ny, f, NULL, NULL);
 return;
-
 } /* diff */
 
 
@@ -4,6 +4,15 @@ float dco
        float w,         /* value at the other point */
        float lambda);   /* contrast parameter */
 
+void diff2dRow
+     (float    ht,        /* time step size */
+      float    lambda,    /* contrast parameter */
+      long     ny,        /* image dimension in y direction */
+      float    *gm,       /* row i-1, i and i+1 of the work copy, */
+      float    *g0,       /* ny+2 values each with the dummy      */
+      float    *gp,       /* boundaries at 0 and ny+1             */
+      float    *f);       /* output: row i smoothed, ny values    */
+
 void diff2d 
      (float    ht,        /* time step size */
       float    lambda,    /* contrast parameter */
@@ -11,3 +20,11 @@ void diff2d
       long     ny,        /* image dimension in y direction */ 
       float    **f);      /* input: original image ;  output: smoothed */
 
+void diff2dResidual
+     (float    ht,        /* time step size */
+      float    lambda,    /* contrast parameter */
+      long     nx,        /* image dimension in x direction */
+      long     ny,        /* image dimension in y direction */
+      float    **f,       /* input: original image ;  output: smoothed */
+      double   *l2,       /* output: root mean square change, may be NULL */
+      double   *linf);    /* output: largest change, may be NULL */
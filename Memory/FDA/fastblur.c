@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pgmfiles.h"
+#include "fastblur.h"
+
+#define TRANSPOSE_BLOCK 32      /* 32x32 floats: 4 KB in and out, fits L1 */
+
+
+/*--------------------------------------------------------------------------*/
+/*                       box blur by summed-area table                      */
+/*--------------------------------------------------------------------------*/
+
+/* S[a][b] is the sum of the image padded by radius replicated pixels,   */
+/* rows < a and columns < b; any window sum is then 4 lookups.            */
+
+void boxBlur(long nx, long ny, float **f, long radius)
+{
+  long   r = radius, w = ny + 2 * r + 1, h = nx + 2 * r + 1;
+  long   i, j;
+  double *S, rowSum, area = (double) (2 * r + 1) * (2 * r + 1);
+  float  *src;
+
+  if (r <= 0) return;
+  if ((S = (double *) malloc(h * w * sizeof(double))) == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+
+  /* ---- build the table ---- */
+
+  memset(S, 0, w * sizeof(double));
+  for (i = 1; i < h; i++)
+    {
+      src = f[i - 1 < r ? 0 : i - 1 - r >= nx ? nx - 1 : i - 1 - r];
+      rowSum = 0.0;
+      S[i * w] = 0.0;
+      for (j = 1; j < w; j++)
+        {
+          rowSum += src[j - 1 < r ? 0 : j - 1 - r >= ny ? ny - 1 : j - 1 - r];
+          S[i * w + j] = S[(i - 1) * w + j] + rowSum;
+        }
+    }
+
+  /* ---- window of pixel (i,j) is rows i..i+2r, columns j..j+2r of the padded image ---- */
+
+#pragma omp parallel for private(j)
+  for (i = 0; i < nx; i++)
+    for (j = 0; j < ny; j++)
+      f[i][j] = (S[(i + 2*r + 1) * w + j + 2*r + 1] - S[i * w + j + 2*r + 1]
+                 - S[(i + 2*r + 1) * w + j] + S[i * w + j]) / area;
+
+  free(S);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                            separable gaussian                            */
+/*--------------------------------------------------------------------------*/
+
+/* convolve each of the rows of m (cols values) with kernel, in place; */
+/* the padded rows of all the threads are allocated before they start  */
+
+static void rowPass(float **m, long rows, long cols, const float *kernel, long r)
+{
+  long i;
+  float *pads;
+  int threads = 1;
+
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  if ((pads = (float *) malloc(threads * (cols + 2 * r) * sizeof(float))) == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+
+#pragma omp parallel num_threads(threads)
+  {
+    float *pad = pads;
+    long j, k;
+    float s;
+
+#ifdef _OPENMP
+    pad += omp_get_thread_num() * (cols + 2 * r);
+#endif
+
+#pragma omp for
+    for (i = 0; i < rows; i++)
+      {
+        for (j = 0; j < r; j++)
+          {
+            pad[j]            = m[i][0];
+            pad[cols + r + j] = m[i][cols - 1];
+          }
+        memcpy(pad + r, m[i], cols * sizeof(float));
+
+        for (j = 0; j < cols; j++)
+          {
+            s = 0.0f;
+            for (k = 0; k <= 2 * r; k++)
+              s += kernel[k] * pad[j + k];
+            m[i][j] = s;
+          }
+      }
+  }
+
+  free(pads);
+}
+
+/* out (cols x rows) = transpose of in (rows x cols), block by block */
+
+static void transpose(float **in, float **out, long rows, long cols)
+{
+  long i0, j0, i, j;
+
+#pragma omp parallel for private(j0, i, j)
+  for (i0 = 0; i0 < rows; i0 += TRANSPOSE_BLOCK)
+    for (j0 = 0; j0 < cols; j0 += TRANSPOSE_BLOCK)
+      for (i = i0; i < rows && i < i0 + TRANSPOSE_BLOCK; i++)
+        for (j = j0; j < cols && j < j0 + TRANSPOSE_BLOCK; j++)
+          out[j][i] = in[i][j];
+}
+
+void gaussBlur(long nx, long ny, float **f, float sigma)
+{
+  long   r = (long) ceil(3.0 * sigma), k;
+  float  *kernel, sum = 0.0f;
+  float  **t;
+
+  if (sigma <= 0.0f) return;
+  if (r < 1) r = 1;
+
+  if ((kernel = (float *) malloc((2 * r + 1) * sizeof(float))) == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+  for (k = -r; k <= r; k++)
+    {
+      kernel[k + r] = expf(-(k * k) / (2.0f * sigma * sigma));
+      sum += kernel[k + r];
+    }
+  for (k = 0; k <= 2 * r; k++)
+    kernel[k] /= sum;
+
+  /* rows, then columns as the rows of the transposed image so the */
+  /* inner loop always walks contiguous memory                     */
+
+  t = allocBlock(ny, nx);
+  rowPass(f, nx, ny, kernel, r);
+  transpose(f, t, nx, ny);
+  rowPass(t, ny, nx, kernel, r);
+  transpose(t, f, ny, nx);
+
+  freeBlock(t);
+  free(kernel);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                      gaussian approximated by boxes                      */
+/*--------------------------------------------------------------------------*/
+
+/* Three box passes whose widths wl and wl+2 are chosen so the variance  */
+/* of the result is the one of the gaussian (Kovesi, Fast almost-        */
+/* gaussian filtering, 2010).                                            */
+
+int gaussBoxBlur(long nx, long ny, float **f, float sigma)
+{
+  long   n = 3, wl, m, pass;
+  double ideal;
+
+  if (sigma <= 0.0f) return(-1);
+
+  ideal = sqrt(12.0 * sigma * sigma / n + 1.0);
+  wl = (long) floor(ideal);
+  if (wl % 2 == 0) wl--;
+  m = lround((12.0 * sigma * sigma - n * wl * wl - 4.0 * n * wl - 3.0 * n) / (-4.0 * wl - 4.0));
+
+  /* below about 0.58 every box is 1 pixel wide: nothing would be done */
+
+  if (wl == 1 && m >= n) return(-1);
+
+  for (pass = 0; pass < n; pass++)
+    boxBlur(nx, ny, f, pass < m ? (wl - 1) / 2 : (wl + 1) / 2);
+  return(0);
+}
@@ -0,0 +1,20 @@
+
+#ifndef FDA_FASTBLUR
+#define FDA_FASTBLUR
+
+/* Large radius smoothing without the O(r^2) work per pixel of a 2D
+   stencil. Borders are replicated as in the stencil engine, so box and
+   gaussian give the results of box3/box5/gauss there, at any radius.
+
+   boxBlur        summed-area table (integral image): O(1) per pixel
+   gaussBlur      separable row pass, then columns as rows of the
+                  transposed image (cache blocked transpose): O(sigma)
+   gaussBoxBlur   three box passes approximating the gaussian: O(1);
+                  -1 when sigma is too small for boxes (under about
+                  0.58), 0 otherwise */
+
+void boxBlur(long nx, long ny, float **f, long radius);
+void gaussBlur(long nx, long ny, float **f, float sigma);
+int gaussBoxBlur(long nx, long ny, float **f, float sigma);
+
+#endif
@@ -2,109 +2,465 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+#include <time.h>
 #include "pgmfiles.h"
 #include "diff2d.h"
+#include "batch.h"
+#include "stream.h"
+#include "packed.h"
+#include "stencil.h"
+#include "fastblur.h"
+#include "pgmtolist.h"
+#include "pgmstats.h"
+#include "roi.h"
+#include "pyramid.h"
 
-//gcc -o fda pgmtolist.c pgmfiles.c diff2d.c main.c -lm
+//gcc -o fda pgmtolist.c pgmfiles.c diff2d.c batch.c stream.c packed.c stencil.c fastblur.c pgmstats.c roi.c pyramid.c main.c -fopenmp -lm -lpthread
+
+/* usage: fda [-l lambda|auto] [-n iterations] [-e tol] [-c csvfile] [-p f32|f16|u16 [-P]]
+              [-F filter [-g sigma] [-a angle]] [-B box:r|gauss:s|gaussbox:s]
+              [-x exportfile] [-M levels[:fine] [-P]] [infile [outfile]]
+          fda -S infile
+          fda -R col,row,width,height [-F filter] -l lambda -n iterations infile outfile
+          fda -b dir|listfile -o outdir -l lambda -n iterations [-e tol] [-t threads]
+          fda -s -l lambda -n iterations infile outfile
+
+   -s streams the image through the iterations a few rows at a time, for
+   images that don't fit in memory.
+   -e stops before the last iteration once the root mean square change of
+   an iteration falls below tol; -c writes the change of every iteration
+   to csvfile.
+   -p keeps the working set in half floats (f16) or 16 bit fixed point
+   (u16) instead of floats; -P then also runs the float path and prints
+   the PSNR of the result against it.
+   -F runs another filter of the stencil engine instead of diff2d (weickert),
+   -F list lists them.
+   -B blurs once, in place of the diffusion, at any radius: box by
+   summed-area table, gauss separable, gaussbox by three boxes.
+   -x also exports the result as a text list, or raw samples / NumPy
+   array when exportfile ends in .raw / .npy.
+   -R filters only the given rectangle of a P5 image, reading the rows it
+   needs and patching it into outfile in place (a copy of infile when
+   outfile doesn't exist yet).
+   -M runs the iterations coarse to fine: the image is reduced levels
+   times by 2x2, smoothed there, expanded back and finished with fine
+   (default 2) iterations at full size; the iterations of -n count as
+   full size ones, one at level L standing for 4^L. -P then also runs the
+   -n iterations at full size and prints both times and the PSNR.
+   -S prints the histogram summary, gradient percentiles and noise level
+   of infile; -l auto takes lambda from the same statistics (90% quantile
+   of the gradient magnitude) instead of asking for it.
+   Missing image names, lambda and iterations are asked for interactively. */
+
+static void usage(const char *name)
+{
+  printf("usage: %s [-l lambda|auto] [-n iterations] [-e tol] [-c csvfile] [-p f32|f16|u16 [-P]]\n"
+         "           [-F filter [-g sigma] [-a angle]] [-B box:r|gauss:s|gaussbox:s]\n"
+         "           [-x exportfile] [-M levels[:fine] [-P]] [infile [outfile]]\n"
+         "       %s -S infile\n"
+         "       %s -R col,row,width,height [-F filter] -l lambda -n iterations infile outfile\n"
+         "       %s -b dir|listfile -o outdir -l lambda -n iterations [-e tol] [-t threads]\n"
+         "       %s -s -l lambda -n iterations infile outfile\n",
+         name, name, name, name, name);
+  exit(1);
+}
 
 void main (int argc, char **argv) {
-  char   row[80];
   float  **matrix;
-  int i, j;
-  FILE   *inimage, *outimage;
-  long   imax;
-  float  lambda;
-  int result;
+  long   i;
+  long   imax = -1;
+  float  lambda = -1;
+  float  tol = 0;
+  double l2, linf, psnr;
+  struct timespec t0, t1;
+  char   *csvName = NULL;
+  FILE   *csv = NULL;
+  int result, opt;
+  int threads = 0, streaming = 0, statsOnly = 0, autoLambda = 0;
+  int store = STORE_F32, psnrReport = 0;
+  packedImage *packed = NULL;
+  const stencilFilter *filter = stencilFind("weickert");
+  stencilParams sp;
+  char *batchInput = NULL, *outDir = NULL, *blur = NULL, *exportName = NULL, *region = NULL;
+  long roi[4];
+  char *pyramid = NULL;
+  int  levels = 0;
+  long fine = 2, coarse;
+  float **reference;
   eightBitPGMImage *PGMImage;
-  
+  PGMStats stats;
+
+  /* ---- read options ---- */
+
+  memset(&sp, 0, sizeof(sp));
+  sp.ht = 0.5;
+
+  while ((opt = getopt(argc, argv, "l:n:b:o:t:se:c:p:PF:g:a:B:x:SR:M:")) != -1)
+    switch (opt)
+      {
+      case 'l':
+        if (strcmp(optarg, "auto") == 0)
+          autoLambda = 1;
+        else
+          lambda = atof(optarg);
+        break;
+      case 'n': imax = atol(optarg); break;
+      case 'b': batchInput = optarg; break;
+      case 'o': outDir = optarg; break;
+      case 't': threads = atoi(optarg); break;
+      case 's': streaming = 1; break;
+      case 'e': tol = atof(optarg); break;
+      case 'c': csvName = optarg; break;
+      case 'p':
+        if (strcmp(optarg, "f32") == 0)
+          store = STORE_F32;
+        else if (strcmp(optarg, "f16") == 0)
+          store = STORE_F16;
+        else if (strcmp(optarg, "u16") == 0)
+          store = STORE_U16;
+        else
+          usage(argv[0]);
+        break;
+      case 'P': psnrReport = 1; break;
+      case 'F':
+        if ((filter = stencilFind(optarg)) == NULL)
+          {
+            for (filter = stencilFilters; filter->name != NULL; filter++)
+              printf("%-12s %s\n", filter->name, filter->help);
+            exit(strcmp(optarg, "list") == 0 ? 0 : 1);
+          }
+        break;
+      case 'g': sp.sigma = atof(optarg); break;
+      case 'a': sp.angle = atof(optarg); break;
+      case 'B': blur = optarg; break;
+      case 'x': exportName = optarg; break;
+      case 'S': statsOnly = 1; break;
+      case 'R': region = optarg; break;
+      case 'M': pyramid = optarg; break;
+      default:
+        usage(argv[0]);
+      }
+
+  if (psnrReport && store == STORE_F32 && !pyramid)
+    {
+      printf("-P compares -p f16|u16 or -M against the float result, it needs one of them\n");
+      exit(1);
+    }
+
+  if ((strcmp(filter->name, "weickert") != 0 || blur) && (batchInput || streaming || store != STORE_F32))
+    {
+      printf("-b, -s and -p only run diff2d\n");
+      exit(1);
+    }
+
+  if (pyramid)
+    {
+      if (sscanf(pyramid, "%d:%ld", &levels, &fine) < 1 || levels < 1 || levels > PYRAMID_MAX_LEVELS || fine < 0 ||
+          strcmp(filter->name, "weickert") != 0 || blur || region || batchInput || streaming ||
+          store != STORE_F32 || tol > 0 || csvName)
+        {
+          printf("-M needs levels (1 to %d)[:fine] and only runs diff2d, without -B, -R, -b, -s, -p, -e or -c\n", PYRAMID_MAX_LEVELS);
+          exit(1);
+        }
+    }
+
+  if (autoLambda && (batchInput || streaming || region))
+    {
+      printf("-l auto needs the whole image, not -b, -s or -R\n");
+      exit(1);
+    }
+
+  /* ---- batch mode: no questions asked ---- */
+
+  if (batchInput)
+    {
+      if (!outDir || lambda <= 0 || imax < 0)
+        {
+          printf("batch mode needs -o, -l and -n\n");
+          exit(1);
+        }
+      exit(fdaBatch(batchInput, outDir, lambda, imax, tol, threads) == 0 ? 0 : 1);
+    }
+
+  /* ---- streaming mode: never holds the whole image ---- */
+
+  if (streaming)
+    {
+      if (optind + 2 != argc || lambda <= 0 || imax < 0)
+        {
+          printf("streaming mode needs -l, -n, infile and outfile\n");
+          exit(1);
+        }
+      if ((result = diff2dStream(argv[optind], argv[optind + 1], lambda, imax)) < 0)
+        {
+          printPGMFileError(result);
+          printf("\n");
+          exit(1);
+        }
+      exit(0);
+    }
+
+  /* ---- region of interest: only the rectangle and its halo are read ---- */
+
+  if (region)
+    {
+      if (sscanf(region, "%ld,%ld,%ld,%ld", &roi[0], &roi[1], &roi[2], &roi[3]) != 4 ||
+          optind + 2 != argc || lambda <= 0 || imax < 0 || blur || store != STORE_F32)
+        {
+          printf("-R needs col,row,width,height, -l, -n, infile and outfile, and no -B or -p\n");
+          exit(1);
+        }
+      sp.lambda = lambda;
+      if ((result = stencilROI(argv[optind], argv[optind + 1], roi[0], roi[1], roi[2], roi[3],
+                               filter, &sp, imax)) < 0)
+        {
+          printPGMFileError(result);
+          printf("\n");
+          exit(1);
+        }
+      exit(0);
+    }
+
   /* ---- read image name  ---- */
-  
+
   PGMImage = (eightBitPGMImage *) malloc(sizeof(eightBitPGMImage));
-	
-  if (!argv[1])
+
+  if (optind >= argc)
   {
-	  printf("name of input PGM image file (with extender): ");
-    scanf("%s", PGMImage->fileName);
+    printf("name of input PGM image file (with extender): ");
+    scanf("%254s", PGMImage->fileName);
   }
   else
   {
-    strcpy(PGMImage->fileName, argv[1]);
+    strncpy(PGMImage->fileName, argv[optind], sizeof(PGMImage->fileName) - 1);
+    PGMImage->fileName[sizeof(PGMImage->fileName) - 1] = '\0';
   }
 
-  result = read8bitPGM(PGMImage);
+  result = readPGM(PGMImage);
 
-  if(result < 0) 
+  if(result < 0)
     {
       printPGMFileError(result);
+      printf("\n");
       exit(result);
     }
 
-  /* ---- allocate storage for matrix ---- */
-  
-  matrix = (float **) malloc (PGMImage->x * sizeof(float *));
-  if (matrix == NULL)
-    { 
+  /* ---- statistics, on the samples as read ---- */
+
+  if (statsOnly || autoLambda)
+    {
+      if (PGMComputeStats(PGMImage, &stats) < 0)
+        {
+          printf("not enough storage available\n");
+          exit(1);
+        }
+      if (statsOnly)
+        {
+          PGMPrintStats(&stats);
+          exit(0);
+        }
+      lambda = PGMAutoLambda(&stats, filter->name);
+      printf("lambda: %g (gradient p90 %.3f)\n", lambda, stats.gradientP90);
+      PGMFreeStats(&stats);
+    }
+
+  /* ---- allocate storage for matrix and read image data into it ---- */
+
+  matrix = NULL;
+  if (store == STORE_F32 || psnrReport)
+    matrix = PGMToMatrix(PGMImage);
+  if (store != STORE_F32)
+    packed = PGMToPacked(PGMImage, store);
+  if ((matrix == NULL && (store == STORE_F32 || psnrReport)) || (packed == NULL && store != STORE_F32))
+    {
       printf("not enough storage available\n");
       exit(1);
-    } 
-  for (i=0; i<PGMImage->x; i++)
-    {
-      matrix[i] = (float *) malloc (PGMImage->y * sizeof(float));
-      if (matrix[i] == NULL)
-        { 
-	  printf("not enough storage available\n");
-	  exit(1);
-        }
-    }
-  
-  /* ---- read image data into matrix ---- */
-  
- for (i=0; i<PGMImage->x; i++)
-    for (j=0; j<PGMImage->y; j++)
-      matrix[i][j] = (float) *(PGMImage->imageData + (i*PGMImage->y) + j); 
-  
+    }
+
+  /* ---- blur: done in one pass, no diffusion afterwards ---- */
+
+  if (blur)
+    {
+      char *arg = strchr(blur, ':');
+      double size = arg ? atof(arg + 1) : 0.0;
+      int box = strncmp(blur, "box:", 4) == 0;
+
+      if ((!box && strncmp(blur, "gauss:", 6) != 0 && strncmp(blur, "gaussbox:", 9) != 0) ||
+          size <= 0.0 || (box && size < 1.0))
+        {
+          printf("-B needs box:radius (at least 1), gauss:sigma or gaussbox:sigma\n");
+          exit(1);
+        }
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (box)
+        boxBlur(PGMImage->x, PGMImage->y, matrix, (long) size);
+      else if (strncmp(blur, "gauss:", 6) == 0)
+        gaussBlur(PGMImage->x, PGMImage->y, matrix, size);
+      else if (strncmp(blur, "gaussbox:", 9) == 0 && gaussBoxBlur(PGMImage->x, PGMImage->y, matrix, size) < 0)
+        {
+          printf("%s: sigma too small for boxes, use gauss:%g\n", blur, size);
+          exit(1);
+        }
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      printf("%s: %.6f s\n", blur, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+      imax = 0;
+      if (lambda <= 0) lambda = 1;
+    }
+
   /* ---- process image ---- */
-  
-  printf("contrast paramter lambda (>0) : ");
-  //~ gets(row);  sscanf(row, "%f", &lambda);
-  scanf("%f", &lambda);
-  printf("number of iterations: ");
-  //~ gets(row);  sscanf(row, "%ld", &imax);
-  scanf("%ld", &imax);
+
+  if (lambda <= 0)
+    {
+      printf("contrast paramter lambda (>0) : ");
+      scanf("%f", &lambda);
+    }
+  if (imax < 0)
+    {
+      printf("number of iterations: ");
+      scanf("%ld", &imax);
+    }
+  sp.lambda = lambda;
+
+  /* ---- coarse to fine: replaces the iterations below ---- */
+
+  if (levels > 0)
+    {
+      if (psnrReport)
+        reference = PGMToMatrix(PGMImage);
+
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      levels = diff2dPyramid(0.5, lambda, PGMImage->x, PGMImage->y, matrix, levels, imax, fine, &coarse);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      printf("pyramid: %ld iterations at 1/%d size, %ld at full size: %.3f s\n", coarse, 1 << levels,
+             fine < imax ? fine : imax,
+             (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+      if (psnrReport)
+        {
+          if (reference == NULL)
+            {
+              printf("not enough storage available\n");
+              exit(1);
+            }
+          clock_gettime(CLOCK_MONOTONIC, &t0);
+          for (i=1; i<=imax; i++)
+            diff2d (0.5, lambda, PGMImage->x, PGMImage->y, reference);
+          clock_gettime(CLOCK_MONOTONIC, &t1);
+          printf("full size: %ld iterations: %.3f s, PSNR of the pyramid against it: %.2f dB\n", imax,
+                 (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9,
+                 matrixPSNR(PGMImage->x, PGMImage->y, matrix, reference, PGMImage->max));
+          freeMatrix(reference, PGMImage->x);
+        }
+      imax = 0;
+    }
+
+  if (csvName)
+    {
+      if ((csv = fopen(csvName, "w")) == NULL)
+        {
+          printf("cannot open %s\n", csvName);
+          exit(1);
+        }
+      fprintf(csv, "iteration,l2,linf,seconds\n");
+    }
+
   for (i=1; i<=imax; i++)
     {
       printf("iteration number: %3ld \n", i);
-      diff2d (0.5, lambda, PGMImage->x, PGMImage->y, matrix); 
+      if (tol <= 0 && !csv)
+        {
+          if (packed)
+            {
+              if (diff2dPacked (0.5, lambda, packed, NULL, NULL) < 0)
+                {
+                  printf("not enough storage available\n");
+                  exit(1);
+                }
+            }
+          else
+            stencilApply (filter, &sp, PGMImage->x, PGMImage->y, matrix, NULL, NULL);
+          continue;
+        }
+
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (packed)
+        {
+          if (diff2dPacked (0.5, lambda, packed, &l2, &linf) < 0)
+            {
+              printf("not enough storage available\n");
+              exit(1);
+            }
+        }
+      else
+        stencilApply (filter, &sp, PGMImage->x, PGMImage->y, matrix, &l2, &linf);
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      if (csv)
+        fprintf(csv, "%ld,%g,%g,%.6f\n", i, l2, linf,
+                (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+      if (tol > 0 && l2 < tol)
+        {
+          printf("converged: change %g < %g\n", l2, tol);
+          break;
+        }
     }
-  
+
+  if (csv)
+    fclose(csv);
+
   /* copy the Result Image to PGM Image/File structure */
 
-  for (i=0; i<PGMImage->x; i++)
-    for (j=0; j<PGMImage->y; j++)
-      *(PGMImage->imageData + i*PGMImage->y + j) = (char) matrix[i][j];
+  if (packed)
+    {
+      if (psnrReport)
+        {
+          imax = i > imax ? imax : i;
+          for (i=1; i<=imax; i++)
+            diff2d (0.5, lambda, PGMImage->x, PGMImage->y, matrix);
+          psnr = packedPSNR(packed, matrix, PGMImage->max);
+          if (isnan(psnr))
+            printf("not enough storage available for the PSNR\n");
+          else
+            printf("PSNR against float: %.2f dB\n", psnr);
+        }
+      if (packedToPGM(packed, PGMImage) < 0)
+        {
+          printf("not enough storage available\n");
+          exit(1);
+        }
+    }
+  else
+    matrixToPGM(matrix, PGMImage);
 
   /* ---- write image ---- */
-  
-  if (!argv[2])
+
+  if (optind + 1 >= argc)
   {
     printf("name of output PGM image file (with extender): ");
-    scanf("%s", PGMImage->fileName);
+    scanf("%254s", PGMImage->fileName);
   }
   else
   {
-    strcpy(PGMImage->fileName, argv[2]);
+    strncpy(PGMImage->fileName, argv[optind + 1], sizeof(PGMImage->fileName) - 1);
+    PGMImage->fileName[sizeof(PGMImage->fileName) - 1] = '\0';
   }
 
   write8bitPGM(PGMImage);
 
+  if (exportName &&
+      (result = exportImage(exportName, exportFormat(exportName), PGMImage->imageData,
+                            PGMImage->y, PGMImage->x, PGMImage->bytesPerSample)) < 0)
+    {
+      printPGMFileError(result);
+      printf("\n");
+    }
+
   /* ---- disallocate storage ---- */
-  
-  for (i=0; i<PGMImage->x; i++)
-    free(matrix[i]);
-  free(matrix);
 
-  free(PGMImage->imageData);
+  if (matrix)
+    freeMatrix(matrix, PGMImage->x);
+  freePacked(packed);
+
+  freePGM(PGMImage);
   free(PGMImage);
 }
-
-
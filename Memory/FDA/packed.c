@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pgmfiles.h"
+#include "diff2d.h"
+#include "packed.h"
+
+
+/*--------------------------------------------------------------------------*/
+/*                         half float <-> float                             */
+/*--------------------------------------------------------------------------*/
+
+#ifndef __F16C__
+
+/* IEEE 754 binary16 conversion with round to nearest even, for machines  */
+/* without F16C.                                                          */
+
+static unsigned short floatToHalf(float v)
+{
+  union { float f; unsigned int u; } x;
+  unsigned int sign, mant, half, rem, halfway;
+  int e, shift;
+
+  x.f = v;
+  sign = (x.u >> 16) & 0x8000;
+  e = (int) ((x.u >> 23) & 0xff) - 112;     /* rebias 127 -> 15 */
+  mant = x.u & 0x7fffff;
+
+  if (e >= 31) return sign | 0x7c00;        /* overflow: infinity */
+
+  if (e <= 0)                               /* half subnormal or zero */
+    {
+      if (e < -10) return sign;
+      mant |= 0x800000;
+      shift = 14 - e;
+      half = mant >> shift;
+      rem = mant & ((1u << shift) - 1);
+      halfway = 1u << (shift - 1);
+      if (rem > halfway || (rem == halfway && (half & 1))) half++;
+      return sign | half;
+    }
+
+  half = ((unsigned int) e << 10) | (mant >> 13);
+  rem = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;  /* may carry into the exponent */
+  return sign | half;
+}
+
+static float halfToFloat(unsigned short h)
+{
+  union { float f; unsigned int u; } x;
+  unsigned int e = (h >> 10) & 0x1f, m = h & 0x3ff;
+
+  if (e == 0)
+    return (h & 0x8000 ? -1.0f : 1.0f) * m * 5.9604644775390625e-8f;  /* m * 2^-24 */
+
+  x.u = ((unsigned int) (h & 0x8000) << 16) |
+        (e == 31 ? 0x7f800000 : ((e + 112) << 23)) | (m << 13);
+  return x.f;
+}
+
+#endif
+
+
+/* ---- row i of the packed image into row[1..ny] with dummy boundaries ---- */
+
+static void unpackRow(packedImage *p, long i, float *row)
+{
+  unsigned short *in = p->data + i * p->ny;
+  float inv = 1.0f / p->scale;
+  long j = 0, ny = p->ny;
+
+  if (p->type == STORE_F16)
+    {
+#ifdef __F16C__
+      for ( ; j + 8 <= ny; j += 8)
+        _mm256_storeu_ps(row + 1 + j,
+          _mm256_mul_ps(_mm256_cvtph_ps(_mm_loadu_si128((__m128i *) (in + j))), _mm256_set1_ps(inv)));
+      for ( ; j < ny; j++)
+        row[j+1] = _cvtsh_ss(in[j]) * inv;
+#else
+      for ( ; j < ny; j++)
+        row[j+1] = halfToFloat(in[j]) * inv;
+#endif
+    }
+  else
+    for ( ; j < ny; j++)
+      row[j+1] = in[j] * inv;
+
+  row[0]    = row[1];
+  row[ny+1] = row[ny];
+}
+
+/* ---- row[0..ny-1] into row i of the packed image ---- */
+
+static void packRow(packedImage *p, long i, float *row)
+{
+  unsigned short *out = p->data + i * p->ny;
+  float v;
+  long j = 0, ny = p->ny;
+
+  if (p->type == STORE_F16)
+    {
+#ifdef __F16C__
+      for ( ; j + 8 <= ny; j += 8)
+        _mm_storeu_si128((__m128i *) (out + j),
+          _mm256_cvtps_ph(_mm256_mul_ps(_mm256_loadu_ps(row + j), _mm256_set1_ps(p->scale)),
+                          _MM_FROUND_TO_NEAREST_INT));
+      for ( ; j < ny; j++)
+        out[j] = _cvtss_sh(row[j] * p->scale, _MM_FROUND_TO_NEAREST_INT);
+#else
+      for ( ; j < ny; j++)
+        out[j] = floatToHalf(row[j] * p->scale);
+#endif
+    }
+  else
+    for ( ; j < ny; j++)
+      {
+        v = row[j] * p->scale + 0.5f;
+        out[j] = v <= 0.0f ? 0 : v >= 65535.0f ? 65535 : (unsigned short) v;
+      }
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+packedImage *PGMToPacked(eightBitPGMImage *PGMImage, int type)
+{
+  packedImage *p;
+  float *row;
+  long i, j;
+
+  if ((p = (packedImage *) malloc(sizeof(packedImage))) == NULL) return(NULL);
+  p->type = type;
+  p->nx = PGMImage->x;
+  p->ny = PGMImage->y;
+
+  /* half floats hold gray levels scaled to [0,1], where they have their
+     full 11 bit precision and 16 bit images can't overflow */
+
+  p->scale = (type == STORE_F16) ? 1.0f / PGMImage->max : 65535.0f / PGMImage->max;
+
+  p->data = (unsigned short *) malloc(p->nx * p->ny * sizeof(unsigned short));
+  row = (float *) malloc(p->ny * sizeof(float));
+  if (p->data == NULL || row == NULL)
+    {
+      free(row);
+      freePacked(p);
+      return(NULL);
+    }
+
+  for (i = 0; i < p->nx; i++)
+    {
+      for (j = 0; j < p->ny; j++)
+        row[j] = (float) PGMSample(PGMImage, i * p->ny + j);
+      packRow(p, i, row);
+    }
+
+  free(row);
+  return(p);
+}
+
+long int packedToPGM(packedImage *p, eightBitPGMImage *PGMImage)
+{
+  float *row = (float *) malloc((p->ny + 2) * sizeof(float));
+  long i, j, k;
+  unsigned int v;
+
+  if (row == NULL) return(PGMMemoryExausted);
+
+  for (i = 0; i < p->nx; i++)
+    {
+      unpackRow(p, i, row);
+      for (j = 0; j < p->ny; j++)
+        {
+          k = i * p->ny + j;
+          v = row[j+1] <= 0.0f ? 0 : row[j+1] + 0.5f >= PGMImage->max ? PGMImage->max :
+              (unsigned int) (row[j+1] + 0.5f);
+          if (PGMImage->bytesPerSample == 1)
+            PGMImage->imageData[k] = v;
+          else
+            {
+              PGMImage->imageData[2*k]   = v >> 8;
+              PGMImage->imageData[2*k+1] = v;
+            }
+        }
+    }
+
+  free(row);
+  return(0);
+}
+
+void freePacked(packedImage *p)
+{
+  if (p == NULL) return;
+  free(p->data);
+  free(p);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+/* diff2d on the packed image. Each thread updates a band of rows in place,
+   keeping the old values of three rows unpacked in a rolling window; the
+   rows just above and below its band belong to the neighbour threads, so
+   they are unpacked before anybody starts writing. The windows are all
+   allocated before the threads start, so none can fail alone and leave
+   the others at the barrier. */
+
+long int diff2dPacked(float ht, float lambda, packedImage *p, double *l2, double *linf)
+{
+  long nx = p->nx, ny = p->ny, window = 5 * (ny + 2);
+  double sum = 0.0, max = 0.0;
+  float *windows;
+  int threads = 1;
+
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  if ((windows = (float *) malloc(threads * window * sizeof(float))) == NULL)
+    return(PGMMemoryExausted);
+
+#pragma omp parallel num_threads(threads) reduction(+:sum) reduction(max:max)
+  {
+    int t = 0, nt = 1;
+    long i, j, start, end;
+    float *buf, *up, *mid, *down, *spare, *below, *out;
+    double d;
+
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+    nt = omp_get_num_threads();
+#endif
+    start = nx * t / nt;
+    end = nx * (t + 1) / nt;
+
+    buf = windows + t * window;
+    up = buf;
+    mid = buf + (ny + 2);
+    spare = buf + 2 * (ny + 2);
+    below = buf + 3 * (ny + 2);
+    out = buf + 4 * (ny + 2);
+
+    if (start < end)
+      {
+        unpackRow(p, start > 0 ? start - 1 : 0, up);
+        unpackRow(p, start, mid);
+        unpackRow(p, end < nx ? end : nx - 1, below);
+      }
+
+#pragma omp barrier
+
+    for (i = start; i < end; i++)
+      {
+        if (i + 1 < end)
+          {
+            down = spare;
+            unpackRow(p, i + 1, down);
+          }
+        else
+          down = below;
+
+        diff2dRow(ht, lambda, ny, up, mid, down, out);
+
+        if (l2 != NULL || linf != NULL)
+          for (j = 0; j < ny; j++)
+            {
+              d = fabs(out[j] - mid[j+1]);
+              sum += d * d;
+              if (d > max) max = d;
+            }
+
+        packRow(p, i, out);
+
+        spare = up;
+        up = mid;
+        mid = down;
+      }
+  }
+
+  free(windows);
+  if (l2 != NULL)   *l2 = sqrt(sum / ((double) nx * ny));
+  if (linf != NULL) *linf = max;
+  return(0);
+}
+
+
+/* peak signal to noise ratio of the packed result against the float one */
+
+double packedPSNR(packedImage *p, float **reference, float max)
+{
+  float *row = (float *) malloc((p->ny + 2) * sizeof(float));
+  double mse = 0.0, d;
+  long i, j;
+
+  if (row == NULL) return(NAN);
+  for (i = 0; i < p->nx; i++)
+    {
+      unpackRow(p, i, row);
+      for (j = 0; j < p->ny; j++)
+        {
+          d = row[j+1] - reference[i][j];
+          mse += d * d;
+        }
+    }
+  free(row);
+
+  mse /= (double) p->nx * p->ny;
+  return(mse > 0.0 ? 10.0 * log10((double) max * max / mse) : INFINITY);
+}
@@ -0,0 +1,38 @@
+
+#ifndef FDA_PACKED
+#define FDA_PACKED
+
+#include "pgmfiles.h"
+
+/* Reduced precision working set for diff2d: the image is kept as 16 bit
+   values, either IEEE half floats or fixed point, and only widened to
+   float in registers while a row is computed. This halves the memory
+   traffic of the stencil against the float matrix, and the in place
+   update needs no work copy of the image.
+   Build with -mf16c (or -march=native) to convert with F16C instructions. */
+
+#define STORE_F32 0    /* float matrix, the reference */
+#define STORE_F16 1    /* half float */
+#define STORE_U16 2    /* unsigned fixed point, 65535 is the image max gray */
+
+typedef struct packedImageStruct {
+  int    type;          /* STORE_F16 or STORE_U16 */
+  long   nx, ny;        /* rows, columns */
+  float  scale;         /* fixed point steps per gray level (STORE_U16) */
+  unsigned short *data; /* nx * ny values, row after row */
+} packedImage;
+
+packedImage *PGMToPacked(eightBitPGMImage *PGMImage, int type); /* NULL when out of memory */
+long int packedToPGM(packedImage *p, eightBitPGMImage *PGMImage); /* PGMMemoryExausted or 0 */
+void freePacked(packedImage *p);
+
+long int diff2dPacked /* PGMMemoryExausted or 0 */
+     (float    ht,        /* time step size */
+      float    lambda,    /* contrast parameter */
+      packedImage *p,     /* input: original image ;  output: smoothed */
+      double   *l2,       /* output: root mean square change, may be NULL */
+      double   *linf);    /* output: largest change, may be NULL */
+
+double packedPSNR(packedImage *p, float **reference, float max); /* dB, against the float result; NAN when out of memory */
+
+#endif
@@ -1,129 +1,392 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "pgmfiles.h"
 
-/* Read a 8 bit .PGM into a matrix
-   allocates memory for the matrix too. */
+/* Read one header number, skipping white space and # comments before it.
+   Returns the position just after the number or 0 on a malformed header. */
+
+static size_t readPGMHeaderNumber(const unsigned char *buf, size_t len, size_t pos, int *value)
+{
+  while (pos < len && (buf[pos] == ' ' || buf[pos] == '\t' || buf[pos] == '\r' ||
+                       buf[pos] == '\n' || buf[pos] == '#'))
+    {
+      if (buf[pos] == '#')
+        while (pos < len && buf[pos] != '\n') pos++;
+      else
+        pos++;
+    }
 
+  if (pos >= len || buf[pos] < '0' || buf[pos] > '9') return(0);
 
-long int read8bitPGM(eightBitPGMImage *PGMImage)
+  *value = 0;
+  while (pos < len && buf[pos] >= '0' && buf[pos] <= '9')
+    {
+      if (*value > 100000000) return(0);
+      *value = *value * 10 + (buf[pos++] - '0');
+    }
+
+  return(pos);
+}
+
+/* white space between the samples of a P2 image */
+
+static int isPGMSpace(unsigned char c)
+{
+  return(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f');
+}
+
+/* Read a .PGM (P2 or P5, 8 or 16 bit) into PGMImage->imageData.
+   P5 files are mapped and imageData points straight into the mapping,
+   P2 files are parsed by hand into a malloc'ed buffer. */
+
+long int readPGM(eightBitPGMImage *PGMImage)
 {
-  char c;
-  int x,y;
-  FILE *filein;
-
-  /* open filein */
-  
-  if ((filein = fopen(PGMImage->fileName,"r")) == NULL) return (PGMFileOpenError); 
- 
-  /* read magic value */
- 
-  if (((c = getc(filein)) != 'P') || ((c = getc(filein)) != '2')) return(PGMFileFormatError);
-
-  while ((c = getc(filein)) != '\n');
-
-  /* read comments */   
-
-  while ((c = getc(filein)) == '#')
-    while ((c = getc(filein)) != '\n');
-    
-  /* read image width */
-  
-  PGMImage->y = 0;
-  do
-    if ((c >= '0') && (c <= '9'))
-      PGMImage->y = PGMImage->y * 10 + (c - '0');
-  while ((c = getc(filein)) != ' ');
-
-	printf("PGMImage->y = %d\n", PGMImage->y);
-  /* read image height */
-
-  PGMImage->x = 0;
-  do
-    if ((c >= '0') && (c <= '9'))
-      PGMImage->x = PGMImage->x * 10 + (c - '0');
-  while ((c = getc(filein)) != ' ');
-    
-	printf("PGMImage->x = %d\n", PGMImage->x);
-  /* read comments */   
-  
-  while ((c = getc(filein)) == '#')
-    while ((c = getc(filein)) != '\n');
-    
-
-  /* read image maxGrey */
-
- PGMImage->max =0;
-  do
-    if (c != ' ')
-      PGMImage->max = PGMImage->max*10 + (c - '0');
-  while ((c = getc(filein)) != '\n');
-
-	printf("PGMImage->max = %d\n", PGMImage->max);
-
-  if (PGMImage->max > 255) return(PGMFileDataIsnt8bit);
-
-  /* alloc space in memory */
-
-  if ((PGMImage->imageData =  (char*) malloc(((PGMImage->x * PGMImage->y) + 1) * sizeof(char) )) == NULL)
+  int fd;
+  struct stat st;
+  unsigned char *buf;
+  size_t len, pos, n, i;
+  int mapped, binary;
+
+  PGMImage->imageData = NULL;
+  PGMImage->mapping = NULL;
+  PGMImage->mappingSize = 0;
+
+  /* map the whole file, or read it when it can't be mapped */
+
+  if ((fd = open(PGMImage->fileName, O_RDONLY)) < 0) return(PGMFileOpenError);
+  if (fstat(fd, &st) < 0 || st.st_size < 2)
+    {
+      close(fd);
+      return(PGMFileFormatError);
+    }
+  len = st.st_size;
+
+  buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  mapped = (buf != MAP_FAILED);
+  if (mapped)
+    madvise(buf, len, MADV_SEQUENTIAL);
+  else
+    {
+      if ((buf = (unsigned char *) malloc(len)) == NULL)
+        {
+          close(fd);
+          return(PGMMemoryExausted);
+        }
+      for (pos = 0; pos < len; )
+        {
+          ssize_t r = read(fd, buf + pos, len - pos);
+          if (r <= 0) break;
+          pos += r;
+        }
+      len = pos;
+    }
+  close(fd);
+
+  /* read magic value and header */
+
+  pos = 0;
+  if (len < 2 || buf[0] != 'P' || (buf[1] != '2' && buf[1] != '5')) goto formatError;
+  binary = (buf[1] == '5');
+
+  if ((pos = readPGMHeaderNumber(buf, len, 2, &PGMImage->y)) == 0) goto formatError;
+  if ((pos = readPGMHeaderNumber(buf, len, pos, &PGMImage->x)) == 0) goto formatError;
+  if ((pos = readPGMHeaderNumber(buf, len, pos, &PGMImage->max)) == 0) goto formatError;
+  if (PGMImage->x <= 0 || PGMImage->y <= 0 || PGMImage->max <= 0 || PGMImage->max > 65535)
+    goto formatError;
+
+  PGMImage->bytesPerSample = (PGMImage->max > 255) ? 2 : 1;
+  n = (size_t) PGMImage->x * PGMImage->y;
+
+  if (binary)
+    {
+      /* a single white space separates maxval from the raster */
+
+      pos++;
+      if (len < pos || len - pos < n * PGMImage->bytesPerSample)
+        {
+          if (mapped) munmap(buf, st.st_size); else free(buf);
+          return(PGMFileTruncated);
+        }
+
+      if (mapped)
+        {
+          PGMImage->imageData = buf + pos;
+          PGMImage->mapping = buf;
+          PGMImage->mappingSize = st.st_size;
+          return(n);
+        }
+
+      memmove(buf, buf + pos, n * PGMImage->bytesPerSample);
+      PGMImage->imageData = buf;
+      return(n);
+    }
+
+  /* P2: alloc space in memory and parse the ASCII samples */
+
+  if ((PGMImage->imageData = (unsigned char *) malloc(n * PGMImage->bytesPerSample + 1)) == NULL)
+    {
+      if (mapped) munmap(buf, st.st_size); else free(buf);
       return(PGMMemoryExausted);
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      unsigned int ch = 0;
+
+      /* white space and comments between the samples, nothing else */
+
+      while (pos < len && (buf[pos] < '0' || buf[pos] > '9'))
+        {
+          if (buf[pos] == '#')
+            while (pos < len && buf[pos] != '\n') pos++;
+          else if (isPGMSpace(buf[pos]))
+            pos++;
+          else
+            break;
+        }
+      if (pos >= len) break;
+      if (buf[pos] < '0' || buf[pos] > '9') goto sampleError;
+
+      while (pos < len && buf[pos] >= '0' && buf[pos] <= '9')
+        {
+          ch = ch * 10 + (buf[pos++] - '0');
+          if (ch > (unsigned int) PGMImage->max) goto sampleError;
+        }
+      if (pos < len && !isPGMSpace(buf[pos]) && buf[pos] != '#') goto sampleError;
+
+      if (PGMImage->bytesPerSample == 1)
+        PGMImage->imageData[i] = ch;
+      else
+        {
+          PGMImage->imageData[2*i] = ch >> 8;
+          PGMImage->imageData[2*i+1] = ch;
+        }
+    }
+
+  if (mapped) munmap(buf, st.st_size); else free(buf);
+
+  if (i < n)
+    {
+      free(PGMImage->imageData);
+      PGMImage->imageData = NULL;
+      return(PGMFileTruncated);
+    }
+
+  return(n);
+
+ sampleError:
+  if (mapped) munmap(buf, st.st_size); else free(buf);
+  free(PGMImage->imageData);
+  PGMImage->imageData = NULL;
+  return(PGMBadSample);
+
+ formatError:
+  if (mapped) munmap(buf, st.st_size); else free(buf);
+  return(PGMFileFormatError);
+}
+
+/* Read the header of a P2 or P5 image from filein, leaving the file at the
+   first sample, for readers that go through the raster a row at a time.
+   Returns the format (2 or 5) or an error code; imageData isn't touched. */
+
+long int readPGMHeader(FILE *filein, eightBitPGMImage *PGMImage)
+{
+  int c, format, field, *value[3];
+
+  if (getc(filein) != 'P') return(PGMFileFormatError);
+  format = getc(filein) - '0';
+  if (format != 2 && format != 5) return(PGMFileFormatError);
+
+  value[0] = &PGMImage->y;
+  value[1] = &PGMImage->x;
+  value[2] = &PGMImage->max;
+
+  for (field = 0; field < 3; field++)
+    {
+      /* skip white space and comments */
+
+      while ((c = getc(filein)) == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#')
+        if (c == '#')
+          while ((c = getc(filein)) != '\n' && c != EOF);
+
+      if (c < '0' || c > '9') return(PGMFileFormatError);
+
+      *value[field] = 0;
+      do
+        {
+          if (*value[field] > 100000000) return(PGMFileFormatError);
+          *value[field] = *value[field] * 10 + (c - '0');
+        }
+      while ((c = getc(filein)) >= '0' && c <= '9');
+    }
 
-  /* read image */
+  /* c is the single white space ending the header */
 
-  for (x = 0 ; x < PGMImage->x ; x++)
-    for (y = 0 ; y < PGMImage->y ; y++)
-	{
-		unsigned int ch; 
-		fscanf(filein,"%u ",&ch);
-	    *(PGMImage->imageData + x*PGMImage->y + y) = ch;
-	}
+  if (PGMImage->x <= 0 || PGMImage->y <= 0 || PGMImage->max <= 0 || PGMImage->max > 65535)
+    return(PGMFileFormatError);
+  if (format == 2 && c != EOF) ungetc(c, filein);
 
-  /* close filein */
+  PGMImage->bytesPerSample = (PGMImage->max > 255) ? 2 : 1;
+  return(format);
+}
+
+/* Read a 8 bit .PGM into a matrix
+   allocates memory for the matrix too. */
+
+long int read8bitPGM(eightBitPGMImage *PGMImage)
+{
+  long int result;
+
+  if ((result = readPGM(PGMImage)) < 0) return(result);
 
-  fclose(filein);
+  if (PGMImage->bytesPerSample != 1)
+    {
+      freePGM(PGMImage);
+      return(PGMFileDataIsnt8bit);
+    }
 
-  return(PGMImage->y * PGMImage->x);
+  return(result);
 }
 
 long int write8bitPGM(eightBitPGMImage *PGMImage)
 {
 
-  int x,y;
+  size_t n;
   FILE  *fileout;
 
   /* open fileout */
-     
+
   if ((fileout = fopen(PGMImage->fileName, "w")) == NULL) return(PGMFileOpenError);
 
   /* write magic value */
-  
+
   fprintf(fileout, "P5\n");
 
   /* write width */
-  
+
   fprintf(fileout,"%d\n", PGMImage->y);
 
   /* write height */
-  
+
   fprintf(fileout,"%d\n", PGMImage->x);
 
   /* write max value */
-  
-  fprintf(fileout,"%d\n", PGMImage->max);   
-
-  /* write image */
-  for (x = 0 ; x < PGMImage->x ; x++)
-    for (y = 0 ; y < PGMImage->y ; y++)
-      putc(*(PGMImage->imageData + x*PGMImage->y + y), fileout);
-      
+
+  fprintf(fileout,"%d\n", PGMImage->max);
+
+  /* write image, 16 bit samples are already big endian */
+
+  n = (size_t) PGMImage->x * PGMImage->y;
+  if (fwrite(PGMImage->imageData, PGMImage->max > 255 ? 2 : 1, n, fileout) != n)
+    {
+      fclose(fileout);
+      return(PGMFileOpenError);
+    }
+
   /* close fileout */
 
   fclose(fileout);
   return(PGMImage->x * PGMImage->y);
 }
 
-void printPGMFileError(long int error) 
+void freePGM(eightBitPGMImage *PGMImage)
+{
+  if (PGMImage->mapping != NULL)
+    munmap(PGMImage->mapping, PGMImage->mappingSize);
+  else
+    free(PGMImage->imageData);
+
+  PGMImage->imageData = NULL;
+  PGMImage->mapping = NULL;
+  PGMImage->mappingSize = 0;
+}
+
+/* Conversion between the image samples and the float matrix the filters
+   work on; matrix[i][j] is row i, column j. NULL when out of memory. */
+
+float **PGMToMatrix(eightBitPGMImage *PGMImage)
+{
+  float **matrix;
+  long int i, j;
+
+  if ((matrix = (float **) malloc(PGMImage->x * sizeof(float *))) == NULL) return(NULL);
+  for (i = 0; i < PGMImage->x; i++)
+    if ((matrix[i] = (float *) malloc(PGMImage->y * sizeof(float))) == NULL)
+      {
+        freeMatrix(matrix, i);
+        return(NULL);
+      }
+
+  for (i = 0; i < PGMImage->x; i++)
+    for (j = 0; j < PGMImage->y; j++)
+      matrix[i][j] = (float) PGMSample(PGMImage, i*PGMImage->y + j);
+
+  return(matrix);
+}
+
+/* values are truncated, and clamped to [0,max] for filters that leave
+   the range of the image */
+
+void matrixToPGM(float **matrix, eightBitPGMImage *PGMImage)
+{
+  long int i, j, p;
+  float m;
+
+  for (i = 0; i < PGMImage->x; i++)
+    for (j = 0; j < PGMImage->y; j++)
+      {
+        p = i*PGMImage->y + j;
+        m = matrix[i][j] < 0.0f ? 0.0f : matrix[i][j] > PGMImage->max ? PGMImage->max : matrix[i][j];
+        if (PGMImage->bytesPerSample == 1)
+          PGMImage->imageData[p] = (unsigned char) m;
+        else
+          {
+            unsigned int v = (unsigned int) m;
+            PGMImage->imageData[2*p]   = v >> 8;
+            PGMImage->imageData[2*p+1] = v;
+          }
+      }
+}
+
+void freeMatrix(float **matrix, long int nx)
+{
+  long int i;
+
+  for (i = 0; i < nx; i++)
+    free(matrix[i]);
+  free(matrix);
+}
+
+/* a rows x cols matrix in one block, for work images; exits when out of memory */
+
+float **allocBlock(long rows, long cols)
+{
+  float **m = (float **) malloc(rows * sizeof(float *));
+  long i;
+
+  if (m == NULL || (m[0] = (float *) malloc(rows * cols * sizeof(float))) == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+  for (i = 1; i < rows; i++)
+    m[i] = m[0] + i * cols;
+  return(m);
+}
+
+void freeBlock(float **m)
+{
+  free(m[0]);
+  free(m);
+}
+
+void printPGMFileError(long int error)
 {
   switch(error) {
-  case -1: 
+  case -1:
     printf("%s", "Error Opening PGM image file");
     break;
   case -2:
@@ -135,6 +398,15 @@ void printPGMFileError(long int error)
   case -4:
     printf("%s", "Error allocating store space for image data");
     break;
+  case -5:
+    printf("%s", "The PGM image file is truncated");
+    break;
+  case -6:
+    printf("%s", "The region is not inside the image");
+    break;
+  case -7:
+    printf("%s", "A sample of the PGM image file is above its max gray or not a number");
+    break;
   default:
     printf("%s", "Unknow error");
   }
@@ -1,3 +1,4 @@
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -8,8 +9,11 @@
 #define PGMFileFormatError -2   /* Error: not a PGM image file */
 #define PGMFileDataIsnt8bit -3  /* The Data in PGM file isn't in 8 bit format */
 #define PGMMemoryExausted -4    /* Error allocating RAM for storing image data */
+#define PGMFileTruncated -5     /* The PGM file has less data than its header says */
+#define PGMRegionOutside -6     /* The region of interest isn't inside the image */
+#define PGMBadSample -7         /* A P2 sample is above max gray or isn't a number */
 
-/* The data type defined below is for manipulating PGM image files data 
+/* The data type defined below is for manipulating PGM image files data
    into programs that use these routines */
 
 typedef struct eightBitPGMImageStruct {
@@ -18,10 +22,27 @@ typedef struct eightBitPGMImageStruct {
   int x,               /* Image width */
     y,                 /* Image height */
     max;               /* Image Max Gray */
+  int bytesPerSample;  /* 1 for max <= 255, 2 for 16 bit samples (stored big endian, as in P5) */
+  void *mapping;       /* mmap'ed file imageData points into, NULL when imageData was malloc'ed */
+  size_t mappingSize;  /* size of the mapping */
 } eightBitPGMImage;
-  
+
+long int readPGM(eightBitPGMImage *PGMImage);      /* read a P2 or P5 Image, 8 or 16 bit, according to the struct PGMImage */
+long int readPGMHeader(FILE *filein, eightBitPGMImage *PGMImage); /* read the header only, returns 2 or 5 (the format) */
 long int read8bitPGM(eightBitPGMImage *PGMImage);  /* read a PGM Image according to the struct PGMImage */
 long int write8bitPGM(eightBitPGMImage *PGMImage); /* write a PGM Image according to the struct PGMImage */
+void freePGM(eightBitPGMImage *PGMImage);          /* release imageData, unmapping the file if needed */
 void printPGMFileError(long int error);        /* print a message corresponding to the error code */
 
+float **PGMToMatrix(eightBitPGMImage *PGMImage);            /* alloc a x by y float matrix holding the image samples */
+void matrixToPGM(float **matrix, eightBitPGMImage *PGMImage); /* store the matrix back into the image samples */
+void freeMatrix(float **matrix, long int nx);                /* disallocate a matrix with nx rows */
+float **allocBlock(long rows, long cols);                    /* rows x cols matrix in one block, exits when out of memory */
+void freeBlock(float **m);                                   /* disallocate a matrix of allocBlock */
+
+/* sample i (row after row) of the image, whatever its sample size */
+
+#define PGMSample(img, i) ((img)->bytesPerSample == 1 ? (unsigned int) (img)->imageData[(i)] : \
+  ((unsigned int) (img)->imageData[2*(i)] << 8) | (img)->imageData[2*(i)+1])
+
 #endif
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pgmfiles.h"
+#include "pgmstats.h"
+
+#define STATS_PI 3.14159265358979
+
+
+/* ---- row i of the image as floats, whatever the sample size ---- */
+
+static void sampleRow(eightBitPGMImage *PGMImage, long i, float *row)
+{
+  long j, ny = PGMImage->y;
+  unsigned char *s = PGMImage->imageData + i * ny * PGMImage->bytesPerSample;
+
+  if (PGMImage->bytesPerSample == 1)
+    for (j = 0; j < ny; j++)
+      row[j] = s[j];
+  else
+    for (j = 0; j < ny; j++)
+      row[j] = (s[2*j] << 8) | s[2*j+1];
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+/* Each thread takes a band of rows and keeps its own histograms and sums, */
+/* merged once at the end. Per row the arithmetic is done in straight      */
+/* loops over float arrays the compiler vectorizes, and only the histogram */
+/* updates are scalar. The buffers of every thread are allocated before  */
+/* the parallel region, so that all of them run the worksharing loop.     */
+
+long int PGMComputeStats(eightBitPGMImage *PGMImage, PGMStats *stats)
+{
+  long   nx = PGMImage->x, ny = PGMImage->y, bins = PGMImage->max + 1;
+  double sum = 0.0, sumSq = 0.0, noiseSum = 0.0, n = (double) nx * ny;
+  double binWidth = (double) PGMImage->max / STATS_GRADIENT_BINS;
+  int    threads = 1, minGray = 65535, maxGray = 0;
+  long   i, k, count, total, *hists;
+  float  *bufs;
+
+  memset(stats, 0, sizeof(PGMStats));
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  stats->histogram = (long *) calloc(bins, sizeof(long));
+  hists = (long *) calloc(threads * (bins + STATS_GRADIENT_BINS), sizeof(long));
+  bufs = (float *) malloc(threads * 4 * ny * sizeof(float));
+  if (stats->histogram == NULL || hists == NULL || bufs == NULL)
+    {
+      free(hists);
+      free(bufs);
+      PGMFreeStats(stats);
+      return(PGMMemoryExausted);
+    }
+
+#pragma omp parallel num_threads(threads) reduction(+:sum, sumSq, noiseSum) reduction(min:minGray) reduction(max:maxGray)
+  {
+    int   t = 0;
+    long  *hist, *gradHist;
+    float *up, *mid, *down, *mag;
+    long  j, b;
+    float gx, gy, lap;
+
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+#endif
+    hist = hists + t * (bins + STATS_GRADIENT_BINS);
+    gradHist = hist + bins;
+    up = bufs + t * 4 * ny;
+    mid = up + ny;
+    down = up + 2 * ny;
+    mag = up + 3 * ny;
+
+#pragma omp for schedule(static)
+    for (i = 0; i < nx; i++)
+      {
+        sampleRow(PGMImage, i > 0 ? i - 1 : 0, up);
+        sampleRow(PGMImage, i, mid);
+        sampleRow(PGMImage, i < nx - 1 ? i + 1 : nx - 1, down);
+
+        /* gray level moments, gradient magnitude and the noise mask */
+        /* 1 -2 1 / -2 4 -2 / 1 -2 1 (interior pixels only)          */
+
+        for (j = 0; j < ny; j++)
+          {
+            sum += mid[j];
+            sumSq += (double) mid[j] * mid[j];
+            gx = 0.5f * (mid[j < ny - 1 ? j + 1 : j] - mid[j > 0 ? j - 1 : j]);
+            gy = 0.5f * (down[j] - up[j]);
+            mag[j] = sqrtf(gx * gx + gy * gy);
+          }
+
+        if (i > 0 && i < nx - 1)
+          for (j = 1; j < ny - 1; j++)
+            {
+              lap = (up[j-1] - 2.0f * up[j] + up[j+1])
+                  - 2.0f * (mid[j-1] - 2.0f * mid[j] + mid[j+1])
+                  + (down[j-1] - 2.0f * down[j] + down[j+1]);
+              noiseSum += fabsf(lap);
+            }
+
+        /* histograms; readPGM doesn't check the samples against max */
+
+        for (j = 0; j < ny; j++)
+          {
+            b = (long) mid[j];
+            hist[b < bins ? b : bins - 1]++;
+            if (mid[j] < minGray) minGray = mid[j];
+            if (mid[j] > maxGray) maxGray = mid[j];
+            b = (long) (mag[j] / binWidth);
+            gradHist[b < STATS_GRADIENT_BINS ? b : STATS_GRADIENT_BINS - 1]++;
+          }
+      }
+
+#pragma omp critical
+    {
+      for (j = 0; j < bins; j++)
+        stats->histogram[j] += hist[j];
+      for (j = 0; j < STATS_GRADIENT_BINS; j++)
+        stats->gradientHistogram[j] += gradHist[j];
+    }
+  }
+
+  free(hists);
+  free(bufs);
+
+  stats->min = minGray;
+  stats->max = maxGray;
+  stats->mean = sum / n;
+  stats->variance = sumSq / n - stats->mean * stats->mean;
+  if (nx > 2 && ny > 2)
+    stats->noise = sqrt(STATS_PI / 2.0) * noiseSum / (6.0 * (nx - 2) * (ny - 2));
+
+  /* ---- percentiles: upper edge of the bin where the count is reached ---- */
+
+  total = nx * ny;
+  for (k = 0, count = 0; k < STATS_GRADIENT_BINS; k++)
+    {
+      count += stats->gradientHistogram[k];
+      if (stats->gradientP50 == 0.0 && count >= 0.50 * total) stats->gradientP50 = (k + 1) * binWidth;
+      if (stats->gradientP90 == 0.0 && count >= 0.90 * total) stats->gradientP90 = (k + 1) * binWidth;
+      if (stats->gradientP99 == 0.0 && count >= 0.99 * total) stats->gradientP99 = (k + 1) * binWidth;
+    }
+
+  return(0);
+}
+
+void PGMFreeStats(PGMStats *stats)
+{
+  free(stats->histogram);
+  stats->histogram = NULL;
+}
+
+void PGMPrintStats(PGMStats *stats)
+{
+  printf("gray levels:        %d .. %d\n", stats->min, stats->max);
+  printf("mean:               %.3f\n", stats->mean);
+  printf("variance:           %.3f (std %.3f)\n", stats->variance, sqrt(stats->variance));
+  printf("gradient p50/90/99: %.3f %.3f %.3f\n",
+         stats->gradientP50, stats->gradientP90, stats->gradientP99);
+  printf("noise std:          %.3f\n", stats->noise);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+/* The contrast parameter is set so edges of the 90% quantile of the      */
+/* gradient magnitude are where diffusion starts to stop. Perona-Malik's  */
+/* g(d) takes lambda in gray levels; for dco of diff2d, exp(-d^0.2/(5     */
+/* lambda)), lambda is chosen so dco is 1/2 at that gradient.             */
+
+float PGMAutoLambda(PGMStats *stats, const char *filter)
+{
+  double d = stats->gradientP90 > 0.0 ? stats->gradientP90 : 1.0;
+
+  if (strncmp(filter, "pm-", 3) == 0)
+    return((float) d);
+  return((float) (pow(d, 0.2) / (5.0 * log(2.0))));
+}
@@ -0,0 +1,31 @@
+
+#ifndef PGM_STATS
+#define PGM_STATS
+
+#include "pgmfiles.h"
+
+#define STATS_GRADIENT_BINS 4096   /* gradient magnitudes 0..max in this many bins */
+
+/* Statistics of an image computed in a single pass over its samples:
+   gray level histogram, mean and variance, percentiles of the gradient
+   magnitude (central differences) and the noise standard deviation
+   (Immerkaer, Fast noise variance estimation, 1996). */
+
+typedef struct PGMStatsStruct {
+  long   *histogram;      /* max+1 bins */
+  long   gradientHistogram[STATS_GRADIENT_BINS];
+  int    min, max;        /* darkest and brightest gray */
+  double mean, variance;
+  double gradientP50, gradientP90, gradientP99;
+  double noise;           /* estimated standard deviation of the noise */
+} PGMStats;
+
+long int PGMComputeStats(eightBitPGMImage *PGMImage, PGMStats *stats); /* PGMMemoryExausted or 0 */
+void PGMFreeStats(PGMStats *stats);
+void PGMPrintStats(PGMStats *stats);
+
+/* contrast parameter for a filter from the gradient statistics */
+
+float PGMAutoLambda(PGMStats *stats, const char *filter);
+
+#endif
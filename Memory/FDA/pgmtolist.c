@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "pgmfiles.h"
+#include "pgmtolist.h"
 
 unsigned char *image; // ,*imageA,*imageB;
 int  width,height,max;
@@ -9,31 +12,17 @@ int  width,height,max;
 
 int point(int x,int y)
 {
-  int p;
-  /* set p to apoint a special point */  
-  
-  p = width*height; 
-  
-  /* set de value of special point to 0 */
-  
-  image[width*height]=0;
+  /* if x and y apoint to a valid point return it, otherwise the special */
+  /* point width*height, set to 0 when the image is read                  */
 
-  /* if x and y apoint to a valid point calculate the value for p */  
-  
-  if (x < width)
-    if  (y < height)
-      if (x >= 0)
-	if (y >= 0) 
-	  p = (y * width) + x;
- 
-  /* return the value of p */
-  return(p);
+  if ((unsigned) x < (unsigned) width && (unsigned) y < (unsigned) height)
+    return((y * width) + x);
+  return(width*height);
 }
 
 void readpgm(char *file)
 {
-  char c;
-  int x,y;
+  eightBitPGMImage header;
   FILE *filein;
 
   /* open filein */
@@ -44,49 +33,16 @@ void readpgm(char *file)
       exit(1);
     }
  
-  /* read magic value */
- 
-  if (((c = getc(filein)) != 'P') || ((c = getc(filein)) != '5'))
+  /* read magic value, width, height and maxGrey, comments allowed */
+
+  if (readPGMHeader(filein, &header) != 5)
     {
       fprintf(stderr,"\nmain:   infile not is PGM\n");
       exit(1);
     }
-  while ((c = getc(filein)) != '\n');
-
-  /* read comments */   
-
-  while ((c = getc(filein)) == '#')
-    while ((c = getc(filein)) != '\n');
-    
-  /* read image width */
-  
-  width = 0;
-  do
-    if ((c >= '0') && (c <= '9'))
-      width = width*10 + (c - '0');
-  while ((c = getc(filein)) != ' ');
-  
-  /* read image height */
-
-  height = 0;
-  do
-    if ((c >= '0') && (c <= '9'))
-      height = height*10 + (c - '0');
-  while ((c = getc(filein)) != '\n');
-    
-  /* read comments */   
-  
-  while ((c = getc(filein)) == '#')
-    while ((c = getc(filein)) != '\n');
-    
-
-  /* read image maxGrey */
-
-  max =0;
-  do
-    if (c != ' ')
-      max = max*10 + (c - '0');
-  while ((c = getc(filein)) != '\n');
+  width = header.y;
+  height = header.x;
+  max = header.max;
   if (max > 255) 
     {    
      fprintf(stderr,"\nonly 8 bits images\n");
@@ -95,17 +51,21 @@ void readpgm(char *file)
   
   /* alloc space in memory */
 
-  if ((image =  (char*) malloc(((width * height) + 1) * sizeof(char) )) == NULL)
+  if ((image =  (unsigned char*) malloc(((width * height) + 1) * sizeof(char) )) == NULL)
     {
       fprintf(stderr,"\ndo not have memory\n");
       exit(1);
     }
+  image[width*height] = 0;
+
   /* read image */
 
-  for (y = 0 ; y < height ; y++)
-    for (x = 0 ; x < width ; x++)
-      image[point(x,y)] = getc(filein);
-  
+  if (fread(image, 1, (size_t) width * height, filein) != (size_t) width * height)
+    {
+      fprintf(stderr,"\nmain:   %s is truncated\n",file);
+      exit(1);
+    }
+
 
   /* close filein */
 
@@ -113,65 +73,182 @@ void readpgm(char *file)
 
 }
 
-void writelist(char *file)
+/*--------------------------------------------------------------------------*/
+/*                               bulk export                                */
+/*--------------------------------------------------------------------------*/
+
+/* "%d " of every 8 bit value, and the two digits of 0..99 for wider ones */
+
+static char byteText[256][4];
+static unsigned char byteTextLength[256];
+static char digitPairs[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static void buildByteText(void)
 {
+  int v;
+
+  if (byteTextLength[1] != 0) return;
+  for (v = 0; v < 256; v++)
+    byteTextLength[v] = sprintf(byteText[v], "%d ", v);
+}
 
-int x,y;
-FILE  *fileout;
+/* write v and a blank at p, returns the position after them */
 
-  /* open fileout */
-     
-  if ((fileout = fopen(file,"w")) == NULL)
+static char *formatSample(char *p, unsigned int v)
+{
+  char digits[8], *d = digits + sizeof(digits);
+
+  while (v >= 100)
     {
-      fprintf(stderr,"\nmain:   cannot open %s\n",file);
-      exit(1);
-    }    
-  /* write image */
-  for (y = 0 ; y < height ; y++) {
-    for (x = 0 ; x < width ; x++) {
-      fprintf(fileout, "%d ", image[point(x,y)]);
+      d -= 2;
+      memcpy(d, digitPairs + 2 * (v % 100), 2);
+      v /= 100;
+    }
+  if (v >= 10)
+    {
+      d -= 2;
+      memcpy(d, digitPairs + 2 * v, 2);
+    }
+  else
+    *--d = '0' + v;
+
+  memcpy(p, d, digits + sizeof(digits) - d);
+  p += digits + sizeof(digits) - d;
+  *p++ = ' ';
+  return(p);
+}
+
+int exportFormat(const char *file)
+{
+  const char *dot = strrchr(file, '.');
+
+  if (dot != NULL && strcmp(dot, ".npy") == 0) return(EXPORT_NPY);
+  if (dot != NULL && strcmp(dot, ".raw") == 0) return(EXPORT_RAW);
+  return(EXPORT_TEXT);
+}
+
+long int exportImage(const char *file, int format, const unsigned char *data,
+                     int width, int height, int bytesPerSample)
+{
+  FILE   *fileout;
+  char   *buffer, *p, header[128];
+  size_t n = (size_t) width * height, size;
+  long   x, y, len;
+
+  if ((fileout = fopen(file, "w")) == NULL) return(PGMFileOpenError);
+
+  if (format == EXPORT_TEXT)
+    {
+      /* the whole list is formatted in memory and written at once */
+
+      size = n * (bytesPerSample == 1 ? 4 : 6) + height;
+      if ((buffer = (char *) malloc(size)) == NULL)
+        {
+          fclose(fileout);
+          return(PGMMemoryExausted);
+        }
+      buildByteText();
+      p = buffer;
+      for (y = 0; y < height; y++)
+        {
+          if (bytesPerSample == 1)
+            for (x = 0; x < width; x++)
+              {
+                memcpy(p, byteText[data[y*width + x]], 4);
+                p += byteTextLength[data[y*width + x]];
+              }
+          else
+            for (x = 0; x < width; x++)
+              p = formatSample(p, (data[2*(y*width + x)] << 8) | data[2*(y*width + x) + 1]);
+          *p++ = '\n';
+        }
+      size = p - buffer;
+      len = fwrite(buffer, 1, size, fileout);
+      free(buffer);
+      if ((size_t) len != size)
+        {
+          fclose(fileout);
+          return(PGMFileOpenError);
+        }
+      fclose(fileout);
+      return(n);
     }
-    fprintf(fileout, "\n");
-  }
-      
-  /* close fileout */
 
+  if (format == EXPORT_NPY)
+    {
+      /* NPY 1.0: magic, version, header length, then a python dict padded */
+      /* with blanks so the data starts at a multiple of 64                 */
+
+      len = sprintf(header + 10, "{'descr': '%s', 'fortran_order': False, 'shape': (%d, %d), }",
+                    bytesPerSample == 1 ? "|u1" : ">u2", height, width);
+      while ((10 + len + 1) % 64 != 0)
+        header[10 + len++] = ' ';
+      header[10 + len++] = '\n';
+      memcpy(header, "\x93NUMPY\x01\x00", 8);
+      header[8] = len & 0xff;
+      header[9] = len >> 8;
+      fwrite(header, 1, 10 + len, fileout);
+    }
+
+  /* raw samples, 16 bit ones big endian as in the PGM file */
+
+  if (fwrite(data, bytesPerSample, n, fileout) != n)
+    {
+      fclose(fileout);
+      return(PGMFileOpenError);
+    }
   fclose(fileout);
+  return(n);
+}
+
+void writelist(char *file)
+{
+  if (exportImage(file, EXPORT_TEXT, image, width, height, 1) < 0)
+    {
+      fprintf(stderr,"\nmain:   cannot write %s\n",file);
+      exit(1);
+    }
 
-  /* disalloc memory */ 
+  /* disalloc memory */
 
   free(image);
 }
 
 /* Main function */
 
-/*int main(argc,argv)
+/* gcc -DPGMTOLIST_MAIN -o pgmtolist pgmtolist.c pgmfiles.c
+   exports a P5 image as a text list, or as .raw/.npy by the extension */
+
+#ifdef PGMTOLIST_MAIN
+int main(argc,argv)
      int argc;
      char *argv[];
 {
-  
+
 
   if (argc != 3)
     {
-      fprintf(stderr,"\nusage: %s infile outfile\n", argv[0]);
+      fprintf(stderr,"\nusage: %s infile outfile[.txt|.raw|.npy]\n", argv[0]);
       exit(1);
     }
 
-  printf("\nreading image"); 
+  printf("\nreading image");
   readpgm (argv[1]);
-  
-
-//  printf("\napplying matched filter");
-//  match();
-//  printf("\napplying bix rim filter");
-//     boxrim(); 
-    
-  printf("\nwriting Results\n");
-  writelist (argv[2]);
-  
-  return 0;    
-}*/
 
 
+//  matched and box rim filters: fda -F matched / fda -F boxrim (stencil.c)
 
+  printf("\nwriting Results\n");
+  if (exportImage(argv[2], exportFormat(argv[2]), image, width, height, 1) < 0)
+    {
+      fprintf(stderr,"\nmain:   cannot write %s\n",argv[2]);
+      exit(1);
+    }
+  free(image);
 
+  return 0;
+}
+#endif
@@ -0,0 +1,17 @@
+
+#ifndef PGM_TO_LIST
+#define PGM_TO_LIST
+
+#define EXPORT_TEXT 0   /* "%d " per sample, a line per row */
+#define EXPORT_RAW  1   /* the samples, row after row */
+#define EXPORT_NPY  2   /* NumPy .npy, uint8 or big endian uint16, shape (height, width) */
+
+int exportFormat(const char *file);   /* EXPORT_NPY for .npy, EXPORT_RAW for .raw, EXPORT_TEXT otherwise */
+
+long int exportImage(const char *file, int format, const unsigned char *data,
+                     int width, int height, int bytesPerSample);  /* samples written or PGM error code */
+
+void readpgm(char *file);    /* P5 8 bit image into image, width, height, max */
+void writelist(char *file);  /* image as a text list, then frees it */
+
+#endif
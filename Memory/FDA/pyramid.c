@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pgmfiles.h"
+#include "diff2d.h"
+#include "pyramid.h"
+
+#define PYRAMID_MIN_SIZE   16     /* no reduction below this many rows or columns */
+
+
+/*--------------------------------------------------------------------------*/
+
+/* Output column j averages input columns 2j and 2j+1 of two rows; the  */
+/* loop over the even columns has no branch and vectorizes, an odd last */
+/* column is done on its own.                                           */
+
+void reduce2x2(long nx, long ny, float **f, float **g)
+{
+  long i, j, mx = (nx + 1) / 2, half = ny / 2;
+
+#pragma omp parallel for private(j)
+  for (i = 0; i < mx; i++)
+    {
+      float *a = f[2*i], *b = f[2*i + 1 < nx ? 2*i + 1 : 2*i], *out = g[i];
+
+#pragma omp simd
+      for (j = 0; j < half; j++)
+        out[j] = 0.25f * (a[2*j] + a[2*j+1] + b[2*j] + b[2*j+1]);
+      if (ny % 2)
+        out[half] = 0.5f * (a[ny-1] + b[ny-1]);
+    }
+}
+
+/* Pixel i of the output is at i/2 - 1/4 on the input grid, so its      */
+/* nearest input pixel i/2 weighs 3/4 and the next one on its side 1/4, */
+/* in both directions. Rows are blended first, then the columns.        */
+
+void expand2x2(long nx, long ny, float **g, float **f)
+{
+  long i, mx = (nx + 1) / 2, my = (ny + 1) / 2;
+  float *rows;
+  int threads = 1;
+
+  /* the blended row of every thread, allocated before they start */
+
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  if ((rows = (float *) malloc(threads * my * sizeof(float))) == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+
+#pragma omp parallel num_threads(threads)
+  {
+    float *row = rows;
+    float *near, *far;
+    long  j, k;
+
+#ifdef _OPENMP
+    row += omp_get_thread_num() * my;
+#endif
+
+#pragma omp for
+    for (i = 0; i < nx; i++)
+      {
+        k = i / 2;
+        near = g[k];
+        far = g[i % 2 ? (k + 1 < mx ? k + 1 : k) : (k > 0 ? k - 1 : 0)];
+
+#pragma omp simd
+        for (j = 0; j < my; j++)
+          row[j] = 0.75f * near[j] + 0.25f * far[j];
+
+        f[i][0] = row[0];
+        for (j = 1; j < ny; j++)
+          {
+            k = j / 2;
+            f[i][j] = 0.75f * row[k] + 0.25f * row[j % 2 ? (k + 1 < my ? k + 1 : k) : k - 1];
+          }
+      }
+
+  }
+
+  free(rows);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+int diff2dPyramid(float ht, float lambda, long nx, long ny, float **f,
+                  int levels, long imax, long fine, long *coarse)
+{
+  float **level[PYRAMID_MAX_LEVELS + 1];
+  long  rows[PYRAMID_MAX_LEVELS + 1], cols[PYRAMID_MAX_LEVELS + 1];
+  long  i;
+  int   k, L = 0;
+
+  /* ---- reduce ---- */
+
+  level[0] = f;
+  rows[0] = nx;
+  cols[0] = ny;
+  while (L < levels && L < PYRAMID_MAX_LEVELS &&
+         rows[L] >= 2 * PYRAMID_MIN_SIZE && cols[L] >= 2 * PYRAMID_MIN_SIZE)
+    {
+      rows[L + 1] = (rows[L] + 1) / 2;
+      cols[L + 1] = (cols[L] + 1) / 2;
+      level[L + 1] = allocBlock(rows[L + 1], cols[L + 1]);
+      reduce2x2(rows[L], cols[L], level[L], level[L + 1]);
+      L++;
+    }
+
+  /* ---- smooth the smallest image, one iteration there for 4^L, then back to full size ---- */
+
+  if (fine > imax) fine = imax;
+  *coarse = imax > fine ? (imax - fine + (1L << 2 * L) - 1) >> (2 * L) : 0;
+  for (i = 0; i < *coarse; i++)
+    diff2d(ht, lambda, rows[L], cols[L], level[L]);
+
+  for (k = L; k > 0; k--)
+    {
+      expand2x2(rows[k - 1], cols[k - 1], level[k], level[k - 1]);
+      freeBlock(level[k]);
+    }
+
+  for (i = 0; i < fine; i++)
+    diff2d(ht, lambda, nx, ny, f);
+  return(L);
+}
+
+double matrixPSNR(long nx, long ny, float **f, float **reference, float max)
+{
+  double sum = 0.0, d;
+  long   i, j;
+
+  for (i = 0; i < nx; i++)
+    for (j = 0; j < ny; j++)
+      {
+        d = f[i][j] - reference[i][j];
+        sum += d * d;
+      }
+  if (sum == 0.0) return(INFINITY);
+  return(10.0 * log10((double) max * max / (sum / ((double) nx * ny))));
+}
@@ -0,0 +1,40 @@
+
+#ifndef FDA_PYRAMID
+#define FDA_PYRAMID
+
+/* Coarse to fine diffusion. The image is reduced levels times by 2x2
+   averaging, most of the iterations run on the smallest image, which is
+   then brought back to full size by bilinear interpolation, one level at
+   a time, and finished with a few iterations at full resolution.
+   Diffusion time grows with the square of the pixel spacing, so one
+   iteration at level L smooths about as much as 4^L at full size, for
+   1/4^L of the work. */
+
+#define PYRAMID_MAX_LEVELS 8
+
+void reduce2x2
+     (long     nx,        /* rows and columns of the input */
+      long     ny,
+      float    **f,       /* input */
+      float    **g);      /* output: (nx+1)/2 x (ny+1)/2, odd last row/column kept */
+
+void expand2x2
+     (long     nx,        /* rows and columns of the output */
+      long     ny,
+      float    **g,       /* input: (nx+1)/2 x (ny+1)/2 */
+      float    **f);      /* output: bilinear interpolation of g */
+
+int diff2dPyramid       /* returns the number of reductions done */
+     (float    ht,        /* time step size */
+      float    lambda,    /* contrast parameter */
+      long     nx,        /* image dimension in x direction */
+      long     ny,        /* image dimension in y direction */
+      float    **f,       /* input: original image ;  output: smoothed */
+      int      levels,    /* most 2x2 reductions, fewer on small images */
+      long     imax,      /* iterations in all, counted at full size */
+      long     fine,      /* of which run at full size at the end, at most imax */
+      long     *coarse);  /* output: iterations run on the smallest image */
+
+double matrixPSNR(long nx, long ny, float **f, float **reference, float max); /* dB */
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pgmfiles.h"
+#include "stencil.h"
+#include "roi.h"
+
+#define ROI_COPY_BUFFER (1 << 20)
+
+
+/* ---- header of a P5 file and the offset of its first sample, then open it ---- */
+
+static long int openP5(const char *name, int flags, eightBitPGMImage *image, off_t *start, int *fd)
+{
+  FILE *file;
+  long int format;
+
+  if ((file = fopen(name, "r")) == NULL) return(PGMFileOpenError);
+  format = readPGMHeader(file, image);
+  *start = ftell(file);
+  fclose(file);
+  if (format < 0) return(format);
+  if (format != 5) return(PGMFileFormatError);
+
+  if ((*fd = open(name, flags)) < 0) return(PGMFileOpenError);
+  return(0);
+}
+
+/* ---- outName becomes a copy of inName, unless it already exists ---- */
+
+static long int copyIfMissing(const char *inName, const char *outName)
+{
+  char    *buffer;
+  ssize_t n = 0;
+  int     fdin, fdout;
+
+  if ((fdout = open(outName, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0)
+    return(errno == EEXIST ? 0 : PGMFileOpenError);
+  if ((fdin = open(inName, O_RDONLY)) < 0)
+    {
+      close(fdout);
+      return(PGMFileOpenError);
+    }
+  if ((buffer = (char *) malloc(ROI_COPY_BUFFER)) != NULL)
+    while ((n = read(fdin, buffer, ROI_COPY_BUFFER)) > 0)
+      if (write(fdout, buffer, n) != n)
+        {
+          n = -1;
+          break;
+        }
+
+  free(buffer);
+  close(fdin);
+  if (close(fdout) != 0 || n != 0)
+    return(buffer == NULL ? PGMMemoryExausted : PGMFileOpenError);
+  return(0);
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+long int stencilROI(const char *inName, const char *outName,
+                    long col, long row, long w, long h,
+                    const stencilFilter *filter, stencilParams *p, long imax)
+{
+  eightBitPGMImage in, out;
+  off_t    inStart, outStart;
+  long int result, halo = imax * filter->radius;
+  long     r0, r1, c0, c1, ww, wh, i, j, k, bps;
+  int      fdin = -1, fdout = -1;
+  unsigned char *raster = NULL;
+  unsigned int  v;
+  float    *block = NULL, **g = NULL, m;
+
+  memset(&in, 0, sizeof(in));
+  memset(&out, 0, sizeof(out));
+  if ((result = openP5(inName, O_RDONLY, &in, &inStart, &fdin)) < 0) return(result);
+  if (col < 0 || row < 0 || w <= 0 || h <= 0 || col + w > in.y || row + h > in.x)
+    {
+      close(fdin);
+      return(PGMRegionOutside);
+    }
+
+  if ((result = copyIfMissing(inName, outName)) < 0 ||
+      (result = openP5(outName, O_WRONLY, &out, &outStart, &fdout)) < 0)
+    {
+      close(fdin);
+      return(result);
+    }
+  if (out.x != in.x || out.y != in.y || out.max != in.max)
+    {
+      result = PGMFileFormatError;
+      goto done;
+    }
+
+  /* ---- region and halo, clipped to the image ---- */
+
+  r0 = row - halo < 0 ? 0 : row - halo;
+  r1 = row + h + halo > in.x ? in.x : row + h + halo;
+  c0 = col - halo < 0 ? 0 : col - halo;
+  c1 = col + w + halo > in.y ? in.y : col + w + halo;
+  wh = r1 - r0;
+  ww = c1 - c0;
+  bps = in.bytesPerSample;
+
+  raster = (unsigned char *) malloc(ww * bps);
+  g = (float **) malloc(wh * sizeof(float *));
+  block = (float *) malloc(wh * ww * sizeof(float));
+  if (raster == NULL || g == NULL || block == NULL)
+    {
+      result = PGMMemoryExausted;
+      goto done;
+    }
+
+  /* ---- read the covering rectangle, a row segment at a time ---- */
+
+  for (i = 0; i < wh; i++)
+    {
+      g[i] = block + i * ww;
+      if (pread(fdin, raster, ww * bps, inStart + ((r0 + i) * in.y + c0) * bps) != ww * bps)
+        {
+          result = PGMFileTruncated;
+          goto done;
+        }
+      for (j = 0; j < ww; j++)
+        g[i][j] = (float) (bps == 1 ? raster[j] : (raster[2*j] << 8) | raster[2*j+1]);
+    }
+
+  /* ---- filter: the halo absorbs the wrong values of the rectangle's border ---- */
+
+  for (k = 0; k < imax; k++)
+    stencilApply(filter, p, wh, ww, g, NULL, NULL);
+
+  /* ---- patch the region into the output, as matrixToPGM stores samples ---- */
+
+  for (i = row; i < row + h; i++)
+    {
+      for (j = 0; j < w; j++)
+        {
+          m = g[i - r0][col - c0 + j];
+          m = m < 0.0f ? 0.0f : m > in.max ? in.max : m;
+          v = (unsigned int) m;
+          if (bps == 1)
+            raster[j] = (unsigned char) v;
+          else
+            {
+              raster[2*j]   = v >> 8;
+              raster[2*j+1] = v;
+            }
+        }
+      if (pwrite(fdout, raster, w * bps, outStart + (i * out.y + col) * bps) != w * bps)
+        {
+          result = PGMFileOpenError;
+          goto done;
+        }
+    }
+  result = w * h;
+
+ done:
+  free(block);
+  free(g);
+  free(raster);
+  close(fdin);
+  if (close(fdout) != 0 && result >= 0) result = PGMFileOpenError;
+  return(result);
+}
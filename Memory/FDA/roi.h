@@ -0,0 +1,28 @@
+
+#ifndef FDA_ROI
+#define FDA_ROI
+
+#include "stencil.h"
+
+/* Region of interest: imax iterations of a stencil filter over the
+   rectangle of width w and height h whose top left pixel is column col,
+   row row of a P5 image, the rest of the image being left as it is.
+
+   A pixel after k iterations depends on its neighbourhood of radius k*R,
+   so only the rectangle grown by that halo is read from infile, a row
+   segment at a time with pread. The rectangle is then patched into
+   outfile in place with pwrite; outfile is made a copy of infile first
+   when it doesn't exist, and may be infile itself. Work and I/O grow with
+   the region, not the image, and the pixels of the region come out as
+   when filtering the whole image. */
+
+long int stencilROI
+     (const char *inName,          /* P5 image, 8 or 16 bit */
+      const char *outName,         /* P5 image of the same size, or created */
+      long     col, long row,      /* top left corner of the region */
+      long     w, long h,          /* size of the region */
+      const stencilFilter *filter,
+      stencilParams *p,
+      long     imax);              /* number of iterations */
+
+#endif
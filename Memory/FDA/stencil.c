@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "diff2d.h"
+#include "stencil.h"
+
+/* tiles: a band of rows is given to a thread, and within the band the    */
+/* rows are filtered one column block at a time so the 2R+1 input row   */
+/* segments stay in the L1/L2 cache while the band goes down            */
+
+#define STENCIL_TILE_ROWS 32
+#define STENCIL_TILE_COLS 1024
+
+#define STENCIL_PI 3.14159265358979f
+
+stencilTimes *stencilProfile = NULL;
+
+/* ---- seconds elapsed since *t, which becomes now ---- */
+
+double stencilLap(struct timespec *t)
+{
+  struct timespec now;
+  double d;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  d = (now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+  *t = now;
+  return(d);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                          row kernel generator                            */
+/*--------------------------------------------------------------------------*/
+
+/* STENCIL_ROW(name, R, WEIGHT, FINISH) defines the row kernel name for a  */
+/* neighbourhood of radius R. WEIGHT is the weight of neighbour (di,dj)    */
+/* of value v for the center value c; FINISH gives the result from c, the */
+/* sum of weights sw and the weighted sum swv. R is a constant, so the    */
+/* neighbour loops unroll, constant weights fold, and the column loop is  */
+/* left to the vectorizer.                                                */
+
+#define STENCIL_ROW(name, R, WEIGHT, FINISH)                                  \
+static void name (const stencilParams *p, long ny, float **rows, float *out)  \
+{                                                                            \
+  long j;                                                                    \
+                                                                             \
+  (void) p;                                                                  \
+  _Pragma("omp simd")                                                        \
+  for (j = 0; j < ny; j++)                                                   \
+    {                                                                        \
+      float c = rows[R][j+R], v, w, sw = 0.0f, swv = 0.0f;                   \
+      int di, dj;                                                            \
+                                                                             \
+      for (di = -R; di <= R; di++)                                           \
+        for (dj = -R; dj <= R; dj++)                                         \
+          {                                                                  \
+            v = rows[R+di][j+R+dj];                                          \
+            w = (WEIGHT);                                                    \
+            sw += w;                                                         \
+            swv += w * v;                                                    \
+          }                                                                  \
+      (void) c; (void) sw;                                                   \
+      out[j] = (FINISH);                                                     \
+    }                                                                        \
+}
+
+/* explicit diffusion step: c + sum w (v - c) */
+
+#define DIFFUSE (c + swv - sw * c)
+
+/* 4 neighbours; ht/2 keeps the explicit scheme stable with diff2d's ht 0.5 */
+
+#define AXIS(di, dj) (((di) == 0) != ((dj) == 0))
+
+#define KERNEL(R) (p->kernel[((di)+(R)) * (2*(R)+1) + (dj)+(R)])
+
+
+/*--------------------------------------------------------------------------*/
+/*                                 filters                                  */
+/*--------------------------------------------------------------------------*/
+
+/* ---- diff2d: Weickert's 9-point stencil, hand written in diff2d.c ---- */
+
+static void weickertRow(const stencilParams *p, long ny, float **rows, float *out)
+{
+  diff2dRow(p->ht, p->lambda, ny, rows[0], rows[1], rows[2], out);
+}
+
+/* ---- Perona-Malik, exponential and rational diffusivity ---- */
+
+STENCIL_ROW(pmExpRow, 1,
+            AXIS(di, dj) ? 0.5f * p->ht * expf(-(v - c) * (v - c) / (p->lambda * p->lambda)) : 0.0f,
+            DIFFUSE)
+
+STENCIL_ROW(pmRationalRow, 1,
+            AXIS(di, dj) ? 0.5f * p->ht / (1.0f + (v - c) * (v - c) / (p->lambda * p->lambda)) : 0.0f,
+            DIFFUSE)
+
+/* ---- box blur ---- */
+
+STENCIL_ROW(box3Row, 1, 1.0f, swv / sw)
+
+STENCIL_ROW(box5Row, 2, 1.0f, swv / sw)
+
+/* ---- gaussian blur, 7x7 ---- */
+
+#define GAUSS_R 3
+
+static void gaussSetup(stencilParams *p)
+{
+  int di, dj;
+  float sum = 0.0f, s = p->sigma > 0.0f ? p->sigma : 1.0f;
+
+  for (di = -GAUSS_R; di <= GAUSS_R; di++)
+    for (dj = -GAUSS_R; dj <= GAUSS_R; dj++)
+      {
+        KERNEL(GAUSS_R) = expf(-(di*di + dj*dj) / (2.0f * s * s));
+        sum += KERNEL(GAUSS_R);
+      }
+  for (di = -GAUSS_R; di <= GAUSS_R; di++)
+    for (dj = -GAUSS_R; dj <= GAUSS_R; dj++)
+      KERNEL(GAUSS_R) /= sum;
+}
+
+STENCIL_ROW(gaussRow, GAUSS_R, KERNEL(GAUSS_R), swv)
+
+/* ---- matched filter (Chaudhuri et al.): dark lines of gaussian profile ---- */
+
+/* The kernel is a segment of an inverted gaussian across the line, 2R+1 */
+/* long along it, rotated to angle and made zero mean so flat regions    */
+/* give 0. Lines darker than their surroundings give positive responses. */
+
+#define MATCHED_R 4
+
+static void matchedSetup(stencilParams *p)
+{
+  int di, dj, n = 0;
+  float s = p->sigma > 0.0f ? p->sigma : 1.5f, a = p->angle * STENCIL_PI / 180.0f;
+  float across, mean = 0.0f;
+
+  for (di = -MATCHED_R; di <= MATCHED_R; di++)
+    for (dj = -MATCHED_R; dj <= MATCHED_R; dj++)
+      {
+        across = dj * cosf(a) + di * sinf(a);
+        KERNEL(MATCHED_R) = fabsf(across) <= 3.0f * s ? -expf(-across * across / (2.0f * s * s)) : 0.0f;
+        if (fabsf(across) <= 3.0f * s)
+          {
+            mean += KERNEL(MATCHED_R);
+            n++;
+          }
+      }
+  mean /= n;
+  for (di = -MATCHED_R; di <= MATCHED_R; di++)
+    for (dj = -MATCHED_R; dj <= MATCHED_R; dj++)
+      if (fabsf(dj * cosf(a) + di * sinf(a)) <= 3.0f * s)
+        KERNEL(MATCHED_R) -= mean;
+}
+
+STENCIL_ROW(matchedRow, MATCHED_R, KERNEL(MATCHED_R), swv)
+
+/* ---- box-rim: mean of the inner 3x3 box minus mean of the 7x7 rim ---- */
+
+#define BOXRIM_R 3
+
+#define RIM(di, dj) (abs(di) == BOXRIM_R || abs(dj) == BOXRIM_R)
+
+STENCIL_ROW(boxRimRow, BOXRIM_R,
+            (abs(di) <= 1 && abs(dj) <= 1) ? 1.0f / 9.0f : RIM(di, dj) ? -1.0f / 24.0f : 0.0f,
+            swv)
+
+
+const stencilFilter stencilFilters[] = {
+  { "weickert",    1,         NULL,         weickertRow,    "diff2d: nonlinear diffusion, 9-point stencil (-l)" },
+  { "pm-exp",      1,         NULL,         pmExpRow,       "Perona-Malik, g = exp(-(d/lambda)^2) (-l)" },
+  { "pm-rational", 1,         NULL,         pmRationalRow,  "Perona-Malik, g = 1/(1+(d/lambda)^2) (-l)" },
+  { "box3",        1,         NULL,         box3Row,        "3x3 box blur" },
+  { "box5",        2,         NULL,         box5Row,        "5x5 box blur" },
+  { "gauss",       GAUSS_R,   gaussSetup,   gaussRow,       "7x7 gaussian blur (-g sigma)" },
+  { "matched",     MATCHED_R, matchedSetup, matchedRow,     "matched filter for dark lines (-g sigma, -a angle)" },
+  { "boxrim",      BOXRIM_R,  NULL,         boxRimRow,      "3x3 box mean minus 7x7 rim mean" },
+  { NULL,          0,         NULL,         NULL,           NULL }
+};
+
+const stencilFilter *stencilFind(const char *name)
+{
+  const stencilFilter *filter;
+
+  for (filter = stencilFilters; filter->name != NULL; filter++)
+    if (strcmp(filter->name, name) == 0)
+      return(filter);
+  return(NULL);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/*                                  engine                                  */
+/*--------------------------------------------------------------------------*/
+
+void stencilApply(const stencilFilter *filter, stencilParams *p,
+                  long nx, long ny, float **f, double *l2, double *linf)
+{
+  long    R = filter->radius, w = ny + 2 * R;
+  long    i, j, k, band, j0, n;
+  float   *block, **g;                    /* work copy of f with dummy boundaries */
+  float   *rows[2 * STENCIL_MAX_RADIUS + 1];
+  double  sum = 0.0, max = 0.0, d;
+  struct timespec t = { 0, 0 };
+
+  if (filter->setup != NULL)
+    filter->setup(p);
+  if (stencilProfile != NULL)
+    clock_gettime(CLOCK_MONOTONIC, &t);
+
+  /* ---- allocate storage for g, one block so the rows are contiguous ---- */
+
+  g = (float **) malloc((nx + 2 * R) * sizeof(float *));
+  block = (float *) malloc((nx + 2 * R) * w * sizeof(float));
+  if (g == NULL || block == NULL)
+    {
+      printf("not enough storage available\n");
+      exit(1);
+    }
+  for (i = 0; i < nx + 2 * R; i++)
+    g[i] = block + i * w;
+  if (stencilProfile != NULL)
+    stencilProfile->allocate += stencilLap(&t);
+
+  /* ---- copy f into g, replicating the border as dummy boundaries ---- */
+
+#pragma omp parallel for private(j)
+  for (i = 0; i < nx + 2 * R; i++)
+    {
+      float *src = f[i < R ? 0 : i - R >= nx ? nx - 1 : i - R];
+
+      for (j = 0; j < R; j++)
+        {
+          g[i][j]          = src[0];
+          g[i][ny + R + j] = src[ny - 1];
+        }
+      memcpy(g[i] + R, src, ny * sizeof(float));
+    }
+  if (stencilProfile != NULL)
+    stencilProfile->pad += stencilLap(&t);
+
+  /* ---- filter, a band of rows per thread, a column tile at a time ---- */
+
+#pragma omp parallel for schedule(static) private(i, j, k, j0, n, rows, d) reduction(+:sum) reduction(max:max)
+  for (band = 0; band < nx; band += STENCIL_TILE_ROWS)
+    for (j0 = 0; j0 < ny; j0 += STENCIL_TILE_COLS)
+      {
+        n = ny - j0 < STENCIL_TILE_COLS ? ny - j0 : STENCIL_TILE_COLS;
+        for (i = band; i < nx && i < band + STENCIL_TILE_ROWS; i++)
+          {
+            for (k = 0; k <= 2 * R; k++)
+              rows[k] = g[i + k] + j0;
+            filter->row(p, n, rows, f[i] + j0);
+
+            if (l2 != NULL || linf != NULL)
+              for (j = 0; j < n; j++)
+                {
+                  d = fabs(f[i][j0 + j] - rows[R][R + j]);
+                  sum += d * d;
+                  if (d > max) max = d;
+                }
+          }
+      }
+
+  if (l2 != NULL)   *l2 = sqrt(sum / ((double) nx * ny));
+  if (linf != NULL) *linf = max;
+  if (stencilProfile != NULL)
+    stencilProfile->compute += stencilLap(&t);
+
+  /* ---- disallocate storage for g ---- */
+
+  free(block);
+  free(g);
+  if (stencilProfile != NULL)
+    stencilProfile->allocate += stencilLap(&t);
+}
@@ -0,0 +1,60 @@
+
+#ifndef FDA_STENCIL
+#define FDA_STENCIL
+
+#include <time.h>
+
+/* Filters of the (2R+1)x(2R+1) neighbourhood of every pixel. The engine
+   (stencilApply) does what all of them share: the work copy with dummy
+   boundaries R pixels wide, traversal in cache sized tiles, threads and
+   the residual of the pass. A filter only gives its row kernel, usually
+   generated in stencil.c from a per neighbour weight expression. */
+
+#define STENCIL_MAX_RADIUS 4
+
+typedef struct stencilParamsStruct {
+  float ht;          /* time step of the diffusion filters */
+  float lambda;      /* contrast parameter of the diffusion filters */
+  float sigma;       /* standard deviation of the gaussian and matched filters */
+  float angle;       /* orientation of the matched filter, in degrees */
+  float kernel[(2*STENCIL_MAX_RADIUS+1) * (2*STENCIL_MAX_RADIUS+1)]; /* filled by setup */
+} stencilParams;
+
+typedef struct stencilFilterStruct {
+  const char *name;
+  int   radius;      /* R: rows and columns of neighbours on each side */
+  void  (*setup)(stencilParams *p);  /* computes p->kernel, may be NULL */
+  void  (*row)(const stencilParams *p, long ny, float **rows, float *out);
+                     /* rows[0..2R]: rows i-R..i+R, each with R dummy values */
+                     /* on both ends; out: ny filtered values of row i      */
+  const char *help;
+} stencilFilter;
+
+/* seconds spent in the phases of stencilApply, added to *stencilProfile
+   when it isn't NULL (benchmarks; calls running concurrently, as in batch
+   mode, must leave it NULL) */
+
+typedef struct stencilTimesStruct {
+  double allocate;   /* work copy malloc and free */
+  double pad;        /* copy of f into it, with the dummy boundaries */
+  double compute;    /* the filter pass */
+} stencilTimes;
+
+extern stencilTimes *stencilProfile;
+
+double stencilLap(struct timespec *t);  /* seconds elapsed since *t, which becomes now */
+
+extern const stencilFilter stencilFilters[];   /* terminated by a NULL name */
+
+const stencilFilter *stencilFind(const char *name);  /* NULL when unknown */
+
+void stencilApply
+     (const stencilFilter *filter,
+      stencilParams *p,   /* filter parameters */
+      long     nx,        /* image dimension in x direction */
+      long     ny,        /* image dimension in y direction */
+      float    **f,       /* input: original image ;  output: filtered */
+      double   *l2,       /* output: root mean square change, may be NULL */
+      double   *linf);    /* output: largest change, may be NULL */
+
+#endif
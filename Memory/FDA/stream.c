@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pgmfiles.h"
+#include "diff2d.h"
+#include "stream.h"
+
+#define STREAM_BUFFER (1 << 20)   /* stdio buffer of the input and output files */
+
+
+typedef struct streamStateStruct {
+  eightBitPGMImage image;   /* header of the image, imageData unused */
+  float    lambda;
+  long     imax;
+  float    ***window;       /* window[k][i%3]: row i of iteration k, ny+2 values */
+  unsigned char *raster;    /* one row of samples as stored in the file */
+  FILE     *filein, *fileout;
+  int      format;          /* 2 or 5 */
+} streamState;
+
+
+/* ---- read row i into window[0] and write row i of window[imax] ---- */
+
+static long int readRow(streamState *s, float *row)
+{
+  long int j, ny = s->image.y, bps = s->image.bytesPerSample;
+  unsigned int v;
+  int c;
+
+  if (s->format == 5)
+    {
+      if (fread(s->raster, bps, ny, s->filein) != (size_t) ny) return(PGMFileTruncated);
+      for (j = 0; j < ny; j++)
+        row[j+1] = (float) (bps == 1 ? s->raster[j] : (s->raster[2*j] << 8) | s->raster[2*j+1]);
+    }
+  else
+    for (j = 0; j < ny; j++)
+      {
+        while ((c = getc(s->filein)) != EOF && (c < '0' || c > '9'))
+          if (c == '#')
+            while ((c = getc(s->filein)) != '\n' && c != EOF);
+        if (c == EOF) return(PGMFileTruncated);
+        v = 0;
+        do
+          v = v * 10 + (c - '0');
+        while ((c = getc(s->filein)) >= '0' && c <= '9');
+        row[j+1] = (float) v;
+      }
+
+  /* dummy boundaries */
+
+  row[0]    = row[1];
+  row[ny+1] = row[ny];
+  return(0);
+}
+
+static long int writeRow(streamState *s, float *row)
+{
+  long int j, ny = s->image.y;
+  unsigned int v;
+
+  for (j = 0; j < ny; j++)
+    if (s->image.bytesPerSample == 1)
+      s->raster[j] = (unsigned char) row[j+1];
+    else
+      {
+        v = (unsigned int) row[j+1];
+        s->raster[2*j]   = v >> 8;
+        s->raster[2*j+1] = v;
+      }
+
+  if (fwrite(s->raster, s->image.bytesPerSample, ny, s->fileout) != (size_t) ny)
+    return(PGMFileOpenError);
+  return(0);
+}
+
+
+/* ---- row i of iteration k is in the window: push it down the cascade ---- */
+
+/* Row i of iteration k completes row i-1 of iteration k+1, which in turn
+   completes row i-2 of iteration k+2 and so on. The rows above the
+   first one are the dummy boundary, i.e. row 0 itself. */
+
+static long int advance(streamState *s, long k, long i)
+{
+  long ny = s->image.y;
+  float *out;
+
+  for ( ; k < s->imax; k++, i--)
+    {
+      if (i < 1) return(0);
+      out = s->window[k+1][(i-1) % 3];
+      diff2dRow(0.5, s->lambda, ny,
+                s->window[k][(i > 1 ? i-2 : 0) % 3], s->window[k][(i-1) % 3], s->window[k][i % 3],
+                out + 1);
+      out[0]    = out[1];
+      out[ny+1] = out[ny];
+    }
+
+  return(writeRow(s, s->window[s->imax][i % 3]));
+}
+
+/* the last row of iteration k: its neighbour below is the dummy boundary */
+
+static long int finish(streamState *s, long k)
+{
+  long nx = s->image.x, ny = s->image.y, i = nx - 1;
+  float *out = s->window[k+1][i % 3];
+
+  diff2dRow(0.5, s->lambda, ny,
+            s->window[k][(i > 0 ? i-1 : 0) % 3], s->window[k][i % 3], s->window[k][i % 3],
+            out + 1);
+  out[0]    = out[1];
+  out[ny+1] = out[ny];
+
+  return(advance(s, k+1, i));
+}
+
+
+/*--------------------------------------------------------------------------*/
+
+long int diff2dStream(const char *inName, const char *outName, float lambda, long imax)
+{
+  streamState s;
+  long int i, k, result = 0;
+
+  memset(&s, 0, sizeof(s));
+  s.lambda = lambda;
+  s.imax = imax;
+
+  if ((s.filein = fopen(inName, "r")) == NULL) return(PGMFileOpenError);
+  setvbuf(s.filein, NULL, _IOFBF, STREAM_BUFFER);
+  if ((s.format = readPGMHeader(s.filein, &s.image)) < 0)
+    {
+      fclose(s.filein);
+      return(s.format);
+    }
+
+  if ((s.fileout = fopen(outName, "w")) == NULL)
+    {
+      fclose(s.filein);
+      return(PGMFileOpenError);
+    }
+  setvbuf(s.fileout, NULL, _IOFBF, STREAM_BUFFER);
+  fprintf(s.fileout, "P5\n%d\n%d\n%d\n", s.image.y, s.image.x, s.image.max);
+
+  /* ---- allocate the windows ---- */
+
+  s.raster = (unsigned char *) malloc(s.image.y * s.image.bytesPerSample);
+  s.window = (float ***) calloc(imax + 1, sizeof(float **));
+  if (s.raster == NULL || s.window == NULL) result = PGMMemoryExausted;
+  for (k = 0; result == 0 && k <= imax; k++)
+    {
+      if ((s.window[k] = (float **) calloc(3, sizeof(float *))) == NULL)
+        result = PGMMemoryExausted;
+      for (i = 0; result == 0 && i < 3; i++)
+        if ((s.window[k][i] = (float *) malloc((s.image.y + 2) * sizeof(float))) == NULL)
+          result = PGMMemoryExausted;
+    }
+
+  /* ---- stream the rows through the iterations ---- */
+
+  for (i = 0; result == 0 && i < s.image.x; i++)
+    if ((result = readRow(&s, s.window[0][i % 3])) == 0)
+      result = advance(&s, 0, i);
+
+  for (k = 0; result == 0 && k < imax; k++)
+    result = finish(&s, k);
+
+  /* ---- disallocate storage ---- */
+
+  for (k = 0; s.window != NULL && k <= imax; k++)
+    if (s.window[k] != NULL)
+      {
+        for (i = 0; i < 3; i++)
+          free(s.window[k][i]);
+        free(s.window[k]);
+      }
+  free(s.window);
+  free(s.raster);
+  fclose(s.filein);
+  if (fclose(s.fileout) != 0 && result == 0) result = PGMFileOpenError;
+
+  return(result < 0 ? result : (long int) s.image.x * s.image.y);
+}
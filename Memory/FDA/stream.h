@@ -0,0 +1,18 @@
+
+#ifndef FDA_STREAM
+#define FDA_STREAM
+
+/* Out of core diffusion: imax iterations of diff2d over an image that is
+   read and written a row at a time. Output row i of iteration k only
+   needs rows i-1..i+1 of iteration k-1, so every iteration keeps a window
+   of 3 rows and the whole cascade holds 3*(imax+1) rows of width+2
+   floats, whatever the image height. The result is the same as running
+   diff2d imax times on the whole image. */
+
+long int diff2dStream
+     (const char *inName,   /* P2 or P5 image, 8 or 16 bit */
+      const char *outName,  /* P5 image written as rows complete */
+      float    lambda,      /* contrast parameter */
+      long     imax);       /* number of iterations */
+
+#endif
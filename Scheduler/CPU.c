@@ -1,12 +1,299 @@
 /**
  * "Virtual" CPU that also maintains track of system time.
+ *
+ * The simulation is driven by events (arrivals, ends of I/O bursts and of
+ * CPU slices) taken from a priority queue in time order, so the clock
+ * jumps from one event to the next whatever the length of the slices or
+ * of the idle periods in between. Arrivals are not queued as events but
+ * read in order from the tasks sorted by arrival, which keeps the queue
+ * as small as the number of tasks in flight.
+ *
+ * There are cpuCount CPUs. They share one ready queue (QUEUE_GLOBAL), or
+ * each has its own (QUEUE_PER_CPU): a task that arrives or wakes up from
+ * I/O goes to the least loaded CPU and otherwise stays where it ran. With
+ * QUEUE_STEAL, a CPU whose queue is empty also takes work from the queue
+ * of another one, starting at a random victim.
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "task.h"
+#include "policy.h"
+#include "event.h"
+#include "CPU.h"
+
+int cpuVerbose = 1;
+EventLog *eventLog = NULL;
+int switchCost = 0;
+int cpuCount = 1;
+int queueMode = QUEUE_GLOBAL;
+int migrationCost = 0;
+
+typedef struct {
+    void *rq;           // ready queue, only the one of CPU 0 with QUEUE_GLOBAL
+    int ready;          // tasks in rq
+    Task *running;      // NULL when idle
+    Task *last;         // last task it ran
+    long busy;          // time spent running tasks
+} Core;
+
+static const char *modeName[] = { "global", "percpu", "steal" };
+
+// system time, and the CPU of the slice being run
+static long now;
+static int cpu;
 
 // run this task for the specified time slice
 void run(Task *task, int slice) {
-    printf("Running task = [%s] [%d] [%d] for %d units.\n",task->name, task->priority, task->burst, slice);
+    if (!cpuVerbose)
+        return;
+    if (cpuCount > 1)
+        printf("%8ld: CPU %d: Running task = [%s] [%d] [%d] for %d units.\n", now, cpu, task->name, task->priority, task->remaining, slice);
+    else
+        printf("%8ld: Running task = [%s] [%d] [%d] for %d units.\n", now, task->name, task->priority, task->remaining, slice);
+}
+
+const char *queueModeName(int mode) {
+    return mode >= 0 && mode <= QUEUE_STEAL ? modeName[mode] : NULL;
+}
+
+int findQueueMode(const char *name) {
+    int mode;
+
+    for (mode = 0; mode <= QUEUE_STEAL; mode++)
+        if (strcmp(modeName[mode], name) == 0)
+            return mode;
+    return -1;
+}
+
+static int byArrival(const void *a, const void *b) {
+    const Task *x = *(Task * const *) a, *y = *(Task * const *) b;
+
+    return x->arrival != y->arrival ? (x->arrival < y->arrival ? -1 : 1) : x->tid - y->tid;
+}
+
+// the task is done on CPU c: account for it
+static void complete(const Policy *policy, void *rq, int c, Task *task, Stats *stats) {
+    task->finish = now;
+    if (eventLog != NULL)
+        logEvent(eventLog, now, LOG_COMPLETE, c, task->tid, task->finish - task->arrival);
+    if (policy->on_complete != NULL)
+        policy->on_complete(rq, task);
+
+    stats->tasks++;
+    stats->turnaround += task->finish - task->arrival;
+    stats->waiting += task->finish - task->arrival - task->burst - task->blocked;
+    stats->response += task->start - task->arrival;
+    if (task->deadline > 0 && task->finish > task->deadline) {
+        stats->missed++;
+        if (eventLog != NULL)
+            logEvent(eventLog, now, LOG_MISS, c, task->tid, task->finish - task->deadline);
+        if (cpuVerbose)
+            printf("%8ld: Deadline miss: task = [%s] deadline %d (late by %ld).\n",
+                   now, task->name, task->deadline, task->finish - task->deadline);
+    }
+}
+
+// put a ready task in a queue; placed tasks (new or back from I/O) go to the least loaded CPU
+static void makeReady(const Policy *policy, Core *core, Task *task, int placed) {
+    int c = 0, i, load, best = -1;
+
+    if (queueMode != QUEUE_GLOBAL) {
+        c = task->cpu >= 0 ? task->cpu : 0;
+        if (placed)
+            for (i = 0; i < cpuCount; i++) {
+                load = core[i].ready + (core[i].running != NULL);
+                if (best < 0 || load < best) {
+                    best = load;
+                    c = i;
+                }
+            }
+    }
+    policy->enqueue(core[c].rq, task);
+    core[c].ready++;
+}
+
+// the next task for CPU c, from its queue or stolen from another one
+static Task *nextTask(const Policy *policy, Core *core, int c, unsigned int *seed, Stats *stats) {
+    Task *task;
+    int q = queueMode == QUEUE_GLOBAL ? 0 : c, i, v;
+
+    if (core[q].ready > 0) {
+        core[q].ready--;
+        return policy->pick_next(core[q].rq);
+    }
+    if (queueMode != QUEUE_STEAL)
+        return NULL;
+
+    *seed = *seed * 1103515245 + 12345;
+    for (i = 0, v = (*seed >> 16) % cpuCount; i < cpuCount; i++, v = (v + 1) % cpuCount)
+        if (v != c && core[v].ready > 0) {
+            core[v].ready--;
+            task = policy->steal != NULL ? policy->steal(core[v].rq) : policy->pick_next(core[v].rq);
+            stats->steals++;
+            return task;
+        }
+    return NULL;
+}
+
+void simulate(const Policy *policy, Task *tasks, int n, Stats *stats) {
+    EventQueue events = { NULL, 0, 0, 0 };
+    Event event;
+    Core core[MAX_CPUS];
+    Task *task;
+    Task **arrivals = malloc(n * sizeof(Task *));
+    unsigned int seed = 1;
+    long busy = 0, most, least;
+    int i, c, slice, cost, next = 0, sorted = 1;
+
+    if (arrivals == NULL) {
+        fprintf(stderr, "out of memory simulating %d tasks\n", n);
+        exit(1);
+    }
+    if (cpuCount < 1 || cpuCount > MAX_CPUS) {
+        fprintf(stderr, "%d CPUs, must be 1 to %d\n", cpuCount, MAX_CPUS);
+        exit(1);
+    }
+
+    memset(stats, 0, sizeof(Stats));
+    memset(core, 0, sizeof(core));
+    for (c = 0; c < (queueMode == QUEUE_GLOBAL ? 1 : cpuCount); c++)
+        core[c].rq = policy->init();
+
+    now = 0;
+    for (i = 0; i < n; i++) {
+        tasks[i].remaining = tasks[i].burst;
+        tasks[i].sinceIO = 0;
+        tasks[i].start = tasks[i].finish = -1;
+        tasks[i].blocked = 0;
+        tasks[i].heapIndex = -1;
+        tasks[i].cpu = -1;
+        tasks[i].level = tasks[i].used = 0;
+        tasks[i].vruntime = 0;
+        arrivals[i] = &tasks[i];
+        if (i > 0 && tasks[i].arrival < tasks[i - 1].arrival)
+            sorted = 0;
+    }
+    if (!sorted)
+        qsort(arrivals, n, sizeof(Task *), byArrival);
+
+    for (;;) {
+        // the next arrival comes before the queued events of the same time
+        if (next < n && (events.size == 0 || arrivals[next]->arrival <= eventNextTime(&events))) {
+            event.time = arrivals[next]->arrival;
+            event.type = EVENT_ARRIVAL;
+            event.task = arrivals[next++];
+        }
+        else if (!eventPop(&events, &event))
+            break;
+        now = event.time;
+        task = event.task;
+
+        switch (event.type) {
+        case EVENT_ARRIVAL:
+            makeReady(policy, core, task, 1);
+            break;
+
+        case EVENT_IO_DONE:
+            task->blocked += task->ioTime;
+            makeReady(policy, core, task, 1);
+            break;
+
+        case EVENT_SLICE_END:
+            c = event.cpu;
+            core[c].running = NULL;
+            if (task->remaining == 0)
+                complete(policy, core[queueMode == QUEUE_GLOBAL ? 0 : c].rq, c, task, stats);
+            else {
+                if (policy->tick != NULL)
+                    policy->tick(core[queueMode == QUEUE_GLOBAL ? 0 : c].rq, task, task->slice);
+                if (task->ioInterval > 0 && task->sinceIO >= task->ioInterval) {
+                    task->sinceIO = 0;
+                    eventPush(&events, now + task->ioTime, EVENT_IO_DONE, c, task);
+                    if (eventLog != NULL)
+                        logEvent(eventLog, now, LOG_BLOCK, c, task->tid, task->ioTime);
+                }
+                else {
+                    makeReady(policy, core, task, 0);
+                    if (eventLog != NULL)
+                        logEvent(eventLog, now, LOG_PREEMPT, c, task->tid, task->remaining);
+                }
+            }
+            break;
+        }
+
+        // dispatch to the idle CPUs once every event of this instant has been seen
+        if (eventNextTime(&events) == now || (next < n && arrivals[next]->arrival == now))
+            continue;
+
+        for (c = 0; c < cpuCount; c++) {
+            if (core[c].running != NULL || (task = nextTask(policy, core, c, &seed, stats)) == NULL)
+                continue;
+
+            cost = 0;
+            if (core[c].last != NULL && task != core[c].last) {
+                stats->switches++;
+                cost = switchCost;
+            }
+            if (task->cpu >= 0 && task->cpu != c) {
+                stats->migrations++;
+                cost += migrationCost;
+            }
+            stats->slices++;
+            core[c].last = core[c].running = task;
+            task->cpu = c;
+
+            slice = policy->slice(core[queueMode == QUEUE_GLOBAL ? 0 : c].rq, task);
+            if (slice > task->remaining)
+                slice = task->remaining;
+            if (task->ioInterval > 0 && slice > task->ioInterval - task->sinceIO)
+                slice = task->ioInterval - task->sinceIO;
+            if (slice < 1 && task->remaining > 0)
+                slice = 1;
+
+            now += cost;
+            cpu = c;
+            if (task->start < 0)
+                task->start = now;
+            run(task, slice);
+            if (eventLog != NULL)
+                logEvent(eventLog, now, LOG_SWITCH, c, task->tid, slice);
+            now -= cost;
+
+            task->slice = slice;
+            task->remaining -= slice;
+            task->sinceIO += slice;
+            core[c].busy += slice;
+            eventPush(&events, now + cost + slice, EVENT_SLICE_END, c, task);
+        }
+    }
+
+    stats->makespan = now;
+    stats->cpus = cpuCount;
+    if (stats->tasks > 0) {
+        stats->turnaround /= stats->tasks;
+        stats->waiting /= stats->tasks;
+        stats->response /= stats->tasks;
+    }
+
+    most = least = core[0].busy;
+    for (c = 0; c < cpuCount; c++) {
+        busy += core[c].busy;
+        if (core[c].busy > most) most = core[c].busy;
+        if (core[c].busy < least) least = core[c].busy;
+        stats->cpuUtilisation[c] = now > 0 ? (double) core[c].busy / now : 0.0;
+    }
+    if (now > 0) {
+        stats->throughput = 1000.0 * stats->tasks / now;
+        stats->utilisation = (double) busy / now / cpuCount;
+    }
+    if (busy > 0)
+        stats->imbalance = (double) (most - least) * cpuCount / busy;
+
+    free(arrivals);
+    eventFree(&events);
+    for (c = 0; c < (queueMode == QUEUE_GLOBAL ? 1 : cpuCount); c++)
+        policy->destroy(core[c].rq);
 }
@@ -1,6 +1,63 @@
+#ifndef CPU_H
+#define CPU_H
+
 // length of a time quantum
 #define QUANTUM 10
 #include "task.h"
+#include "policy.h"
+#include "eventlog.h"
+
+#define MAX_CPUS 64
+
+// where ready tasks wait when there are several CPUs
+#define QUEUE_GLOBAL  0     // one queue for all the CPUs
+#define QUEUE_PER_CPU 1     // a queue per CPU, tasks placed on the least loaded
+#define QUEUE_STEAL   2     // per CPU, and idle CPUs steal from the others
+
+// what a simulation measured; times are averages over the tasks
+typedef struct {
+    int tasks;
+    long makespan;          // time the last task completed
+    double turnaround;      // completion - arrival
+    double waiting;         // turnaround - burst - time in I/O
+    double response;        // first run - arrival
+    double throughput;      // tasks per 1000 time units
+    double utilisation;     // share of the makespan the CPUs spent running tasks
+    double cpuUtilisation[MAX_CPUS];
+    double imbalance;       // (busiest - idlest CPU busy time) / mean busy time
+    int cpus;
+    long switches;          // dispatches of a task other than the one that ran last
+    long slices;            // dispatches
+    long migrations;        // slices run on another CPU than the task's previous one
+    long steals;            // tasks taken from the queue of another CPU
+    int missed;             // tasks completing after their deadline
+} Stats;
+
+// print the slices run() is given (on by default)
+extern int cpuVerbose;
+
+// where simulate() records the slices and completions, NULL for nowhere
+extern EventLog *eventLog;
+
+// time a context switch takes, added before a different task runs
+extern int switchCost;
+
+// number of CPUs, how they queue ready tasks, and the time a task
+// takes to run on another CPU than before (cold caches), added to
+// the context switch
+extern int cpuCount;
+extern int queueMode;
+extern int migrationCost;
+
+// name of a queue mode and back, NULL / -1 when unknown
+const char *queueModeName(int mode);
+int findQueueMode(const char *name);
 
 // run the specified task for the following time slice
 void run(Task *task, int slice);
+
+// run the n tasks to completion under policy: discrete-event simulation
+// of their arrivals, CPU slices and I/O bursts
+void simulate(const Policy *policy, Task *tasks, int n, Stats *stats);
+
+#endif
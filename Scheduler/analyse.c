@@ -0,0 +1,176 @@
+/**
+ * Schedulability analysis of a set of periodic tasks (see schedulability.h).
+ *
+ * The taskset has a task per line,
+ *
+ *  [name], [cost], [period][, deadline[, jitter]]
+ *
+ * the deadline relative to the release and by default the period, the
+ * jitter by default 0; gen -A writes such sets. Every test is run on the
+ * whole set, then the tasks are admitted one at a time into an empty set,
+ * in the order of the file, under fixed priorities and under EDF.
+ *
+ * usage: analyse [-t] [-r repeats] taskset-file
+ *
+ * -t prints the exact worst case response time of every task, -r repeats the tests and
+ * the admissions to time them (the fastest run is printed).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "schedulability.h"
+
+#define SIZE    256
+
+static double seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// the tasks of the file, in its order; NULL after printing why
+static PeriodicTask *readTaskSet(const char *path, int *n) {
+    FILE *in;
+    char line[SIZE], name[SIZE];
+    PeriodicTask *tasks = NULL, *grown;
+    int capacity = 0, fields, number = 0;
+
+    if ((in = fopen(path, "r")) == NULL) {
+        perror(path);
+        return NULL;
+    }
+    *n = 0;
+    while (fgets(line, SIZE, in) != NULL) {
+        number++;
+        if (line[strspn(line, " \t\r\n")] == '\0' || line[strspn(line, " \t")] == '#')
+            continue;
+        if (*n == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            if ((grown = realloc(tasks, capacity * sizeof(PeriodicTask))) == NULL) {
+                fprintf(stderr, "out of memory reading %s\n", path);
+                break;
+            }
+            tasks = grown;
+        }
+        memset(&tasks[*n], 0, sizeof(PeriodicTask));
+        fields = sscanf(line, " %[^,], %ld, %ld, %ld, %ld", name, &tasks[*n].cost, &tasks[*n].period,
+                        &tasks[*n].deadline, &tasks[*n].jitter);
+        if (fields < 3) {
+            fprintf(stderr, "%s:%d: expected name, cost, period[, deadline[, jitter]]\n", path, number);
+            break;
+        }
+        if (fields < 4)
+            tasks[*n].deadline = tasks[*n].period;
+        tasks[*n].name = strdup(name);
+        (*n)++;
+    }
+
+    if (feof(in) && *n == 0)
+        fprintf(stderr, "%s: no tasks\n", path);
+    if (!feof(in) || *n == 0) {
+        while ((*n)-- > 0)
+            free((char *) tasks[*n].name);
+        free(tasks);
+        tasks = NULL;
+    }
+    fclose(in);
+    return tasks;
+}
+
+static const char *verdict(int result) {
+    return result == SCHEDULABLE ? "yes" : "no";
+}
+
+int main(int argc, char *argv[])
+{
+    PeriodicTask *tasks;
+    TaskSet set, fp, edf;
+    int n, i, r, opt, repeats = 1, perTask = 0, result[4], admittedFP = 0, admittedEDF = 0;
+    double t0, best[6] = { 1e300, 1e300, 1e300, 1e300, 1e300, 1e300 }, t[6];
+    static const char *test[4] = {
+        "Liu & Layland (rate monotonic, D = T)", "hyperbolic bound (rate monotonic, D = T)",
+        "response time analysis (deadline monotonic)", "processor demand, QPA (EDF)" };
+
+    while ((opt = getopt(argc, argv, "tr:")) != -1)
+        switch (opt) {
+        case 't': perTask = 1; break;
+        case 'r': repeats = atoi(optarg); break;
+        default: optind = argc; break;
+        }
+    if (optind + 1 != argc || repeats < 1) {
+        fprintf(stderr, "usage: %s [-t] [-r repeats] taskset-file\n", argv[0]);
+        return 1;
+    }
+    if ((tasks = readTaskSet(argv[optind], &n)) == NULL)
+        return 1;
+
+    taskSetInit(&set);
+    for (i = 0; i < n; i++)
+        if (taskSetAdd(&set, &tasks[i]) < 0) {
+            fprintf(stderr, "task %s: needs 0 < cost <= deadline - jitter, deadline <= period\n",
+                    tasks[i].name);
+            return 1;
+        }
+
+    for (r = 0; r < repeats; r++) {
+        t0 = seconds();
+        result[0] = liuLaylandTest(&set);
+        t[0] = seconds() - t0;
+        t0 = seconds();
+        result[1] = hyperbolicTest(&set);
+        t[1] = seconds() - t0;
+        t0 = seconds();
+        result[2] = responseTimeTest(&set);
+        t[2] = seconds() - t0;
+        t0 = seconds();
+        result[3] = processorDemandTest(&set);
+        t[3] = seconds() - t0;
+
+        // admission of each task in turn
+        taskSetInit(&fp);
+        taskSetInit(&edf);
+        t0 = seconds();
+        for (i = 0, admittedFP = 0; i < n; i++)
+            admittedFP += admitFixedPriority(&fp, &tasks[i]);
+        t[4] = seconds() - t0;
+        t0 = seconds();
+        for (i = 0, admittedEDF = 0; i < n; i++)
+            admittedEDF += admitEDF(&edf, &tasks[i]);
+        t[5] = seconds() - t0;
+        taskSetFree(&fp);
+        taskSetFree(&edf);
+
+        for (i = 0; i < 6; i++)
+            if (t[i] < best[i])
+                best[i] = t[i];
+    }
+
+    printf("%d tasks, utilisation %.4f, hyperbolic product %.4f, density %.4f\n",
+           set.n, set.utilisation, set.hyperbolic, set.density);
+    printf("%-45s %-4s %10s\n", "test", "", "ms");
+    for (i = 0; i < 4; i++)
+        printf("%-45s %-4s %10.3f\n", test[i], verdict(result[i]), 1e3 * best[i]);
+    printf("%-45s %4d %10.3f\n", "admitted one by one, fixed priority", admittedFP, 1e3 * best[4]);
+    printf("%-45s %4d %10.3f\n", "admitted one by one, EDF", admittedEDF, 1e3 * best[5]);
+
+    if (perTask) {
+        // the analysis may have stopped at an upper bound
+        printf("\n%-10s %8s %8s %8s %8s %10s\n", "task", "cost", "period", "deadline", "jitter", "response");
+        for (i = 0; i < set.n; i++) {
+            r = exactResponseTime(&set, i);
+            printf("%-10s %8ld %8ld %8ld %8ld %10ld%s\n", set.task[i].name, set.task[i].cost,
+                   set.task[i].period, set.task[i].deadline, set.task[i].jitter, r, r < 0 ? "  misses" : "");
+        }
+    }
+
+    taskSetFree(&set);
+    for (i = 0; i < n; i++)
+        free((char *) tasks[i].name);
+    free(tasks);
+    return 0;
+}
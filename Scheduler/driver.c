@@ -4,52 +4,158 @@
  * Schedule is in the format
  *
  *  [name] [priority] [CPU burst]
+ *
+ * optionally followed by
+ *
+ *  [deadline] [arrival] [CPU time between I/O bursts] [I/O burst]
+ *
+ * fields separated by commas, or is a binary trace (see trace.h).
+ * A deadline of 0 is none (it is used by EDF and counted as missed by
+ * every policy); tasks arrive at 0 and do no I/O unless told otherwise.
+ *
+ * usage: schedule [-p policy|all] [-c switch cost] [-n cpus [-m queues|all] [-M migration cost]]
+ *                 [-Q quanta] [-b boost] [-q] [-t] [-l log-file] [-w binary-file] schedule-file
+ *
+ * -p picks the policy (default rr_p); all runs every policy over the
+ * trace and prints a comparison. -c is the time a context switch takes.
+ * -n simulates several CPUs sharing one ready queue (-m global, the
+ * default) or with a queue each (percpu), idle ones stealing from the
+ * others (steal); -m all compares the three. -M is the extra time a task
+ * takes when it runs on another CPU than before.
+ * -Q sets the MLFQ levels and their quanta (comma separated, top level
+ * first, default 10,20,40), -b the CPU time between two MLFQ boosts.
+ * -q leaves out the slices, -t adds the times of every task.
+ * -l records the slices, completions and deadline misses in a binary
+ * event log instead of printing them (see eventlog.h), for one policy
+ * and queue mode; timeline turns it into a Chrome trace or a Gantt chart.
+ * -w saves the schedule as a binary trace instead of running it.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "task.h"
-#include "list.h"
-#include "schedule_rr_p.h"
-#include "schedule_edf.h"
+#include "policy.h"
+#include "CPU.h"
+#include "trace.h"
+
+static void printHeader(void) {
+    printf("%-10s %8s %10s %12s %12s %12s %10s %6s %10s %8s", "policy", "tasks", "makespan",
+           "turnaround", "waiting", "response", "tasks/1000", "cpu %", "switches", "missed");
+    if (cpuCount > 1)
+        printf(" %-7s %10s %10s %9s", "queues", "migrations", "steals", "imbalance");
+    printf("\n");
+}
+
+static void printStats(const char *name, Stats *stats) {
+    int c;
+
+    printf("%-10s %8d %10ld %12.1f %12.1f %12.1f %10.3f %6.1f %10ld %8d", name, stats->tasks,
+           stats->makespan, stats->turnaround, stats->waiting, stats->response, stats->throughput,
+           100.0 * stats->utilisation, stats->switches, stats->missed);
+    if (cpuCount > 1) {
+        printf(" %-7s %10ld %10ld %9.3f\n%10s", queueModeName(queueMode), stats->migrations,
+               stats->steals, stats->imbalance, "cpu %");
+        for (c = 0; c < stats->cpus; c++)
+            printf(" %5.1f", 100.0 * stats->cpuUtilisation[c]);
+    }
+    printf("\n");
+}
 
-#define SIZE    100
+static void printTasks(Task *tasks, int n) {
+    int i;
+
+    printf("%-10s %8s %8s %8s %8s %12s %12s %12s\n", "task", "arrival", "burst", "start", "finish",
+           "turnaround", "waiting", "response");
+    for (i = 0; i < n; i++)
+        printf("%-10s %8d %8d %8ld %8ld %12ld %12ld %12ld\n", tasks[i].name, tasks[i].arrival,
+               tasks[i].burst, tasks[i].start, tasks[i].finish, tasks[i].finish - tasks[i].arrival,
+               tasks[i].finish - tasks[i].arrival - tasks[i].burst - tasks[i].blocked,
+               tasks[i].start - tasks[i].arrival);
+}
 
 int main(int argc, char *argv[])
 {
-    FILE *in;
-    char *temp;
-    char task[SIZE];
-
-    char *name;
-    int priority;
-    int burst;
-    int deadline;
-
-    in = fopen(argv[1],"r");
-    
-    while (fgets(task,SIZE,in) != NULL) {
-        temp = strdup(task);
-        name = strsep(&temp,",");
-        priority = atoi(strsep(&temp,","));
-        burst = atoi(strsep(&temp,","));
-        //Only to EDF algorithm
-        deadline = atoi(srtsep(&temp, ","));
-
-        // add the task to the scheduler's list of tasks
-        add(name,priority,burst);
-        //to EDF only
-        add(name,priority,burst, deadline);
-
-        free(temp);
-    }
+    Trace trace;
+    Task *tasks;
+    int n, i, opt, perTask = 0, mode, allModes = 0, first = 1;
+    const char *policyName = "rr_p", *binaryName = NULL, *logName = NULL;
+    const Policy *policy;
+    Stats stats;
 
-    fclose(in);
+    while ((opt = getopt(argc, argv, "p:c:n:m:M:Q:b:qtl:w:")) != -1)
+        switch (opt) {
+        case 'p': policyName = optarg; break;
+        case 'c': switchCost = atoi(optarg); break;
+        case 'n': cpuCount = atoi(optarg); break;
+        case 'm':
+            if (strcmp(optarg, "all") == 0)
+                allModes = 1;
+            else if ((queueMode = findQueueMode(optarg)) < 0)
+                optind = argc;
+            break;
+        case 'M': migrationCost = atoi(optarg); break;
+        case 'Q':
+            for (mlfqLevels = 0; optarg != NULL && mlfqLevels < MLFQ_MAX_LEVELS; mlfqLevels++)
+                if ((mlfqQuantum[mlfqLevels] = atoi(strsep(&optarg, ","))) < 1)
+                    optind = argc;
+            if (optarg != NULL)
+                optind = argc;
+            break;
+        case 'b': mlfqBoost = atoi(optarg); break;
+        case 'q': cpuVerbose = 0; break;
+        case 't': perTask = 1; break;
+        case 'l': logName = optarg; break;
+        case 'w': binaryName = optarg; break;
+        default: optind = argc; break;
+        }
+
+    policy = findPolicy(policyName);
+    if (optind + 1 != argc || (policy == NULL && strcmp(policyName, "all") != 0) ||
+        cpuCount < 1 || cpuCount > MAX_CPUS || mlfqBoost < 1 || (logName != NULL && (policy == NULL || allModes))) {
+        fprintf(stderr, "usage: %s [-p policy|all] [-c switch cost] [-n cpus [-m global|percpu|steal|all]\n"
+                "          [-M migration cost]] [-Q quanta] [-b boost] [-q] [-t] [-l log-file]\n"
+                "          [-w binary-file] schedule-file\npolicies:\n", argv[0]);
+        for (i = 0; policies[i] != NULL; i++)
+            fprintf(stderr, "  %-10s %s\n", policies[i]->name, policies[i]->description);
+        return 1;
+    }
+    if (loadTrace(argv[optind], &trace) < 0)
+        return 1;
+    if (binaryName != NULL) {
+        i = saveTrace(binaryName, &trace);
+        freeTrace(&trace);
+        return i < 0;
+    }
+    tasks = trace.tasks;
+    n = trace.n;
+    if (logName != NULL) {
+        if ((eventLog = logOpen(logName, tasks, n, cpuCount, policy->name)) == NULL) {
+            freeTrace(&trace);
+            return 1;
+        }
+        cpuVerbose = 0;
+    }
 
-    // invoke the scheduler
-    schedule();
+    // invoke the scheduler, or all of them over the same tasks
+    if (policy == NULL || allModes)
+        cpuVerbose = 0;
+    for (i = 0; policies[i] != NULL; i++)
+        for (mode = 0; mode <= QUEUE_STEAL; mode++)
+            if ((policy == NULL || policies[i] == policy) && (allModes || mode == queueMode)) {
+                queueMode = mode;
+                simulate(policies[i], tasks, n, &stats);
+                if (perTask)
+                    printTasks(tasks, n);
+                if (first || perTask)
+                    printHeader();
+                printStats(policies[i]->name, &stats);
+                first = 0;
+            }
 
-    return 0;
+    i = eventLog != NULL && logClose(eventLog) < 0;
+    freeTrace(&trace);
+    return i;
 }
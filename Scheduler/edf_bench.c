@@ -0,0 +1,144 @@
+/**
+ * EDF pick-next cost: the intrusive heap against a scan of list.c's list.
+ *
+ * Both schedule the same generated taskset (random bursts and deadlines)
+ * to completion without printing, and must produce the same order; the
+ * time of each and the number of scheduling decisions are printed. The
+ * list scan is quadratic, so it only runs up to list-max tasks (default
+ * 30000, some 15 s), larger sizes time the heap alone.
+ *
+ *  edf_bench [-l list-max] [tasks...]    default 1000 10000 30000 100000
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "task.h"
+#include "list.h"
+#include "heap.h"
+#include "CPU.h"
+
+static double seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// tasks with bursts in [1, 100] and deadlines up to their expected completion
+static Task *generate(int n, char names[][16]) {
+    Task *tasks = malloc(n * sizeof(Task));
+    int i;
+
+    srand(1);
+    for (i = 0; i < n; i++) {
+        snprintf(names[i], 16, "T%d", i);
+        tasks[i].name = names[i];
+        tasks[i].tid = i;
+        tasks[i].priority = 1;
+        tasks[i].burst = 1 + rand() % 100;
+        tasks[i].deadline = rand() % (50 * n + 1);
+        tasks[i].heapIndex = -1;
+    }
+    return tasks;
+}
+
+// returns a checksum of the order the slices ran in
+static unsigned long heapSchedule(Task *tasks, int n, long *decisions) {
+    TaskHeap ready = { NULL, 0, 0, NULL };
+    unsigned long order = 0;
+    Task *task;
+    int i, slice;
+
+    for (i = 0; i < n; i++)
+        heapPush(&ready, &tasks[i]);
+    while ((task = heapPop(&ready)) != NULL) {
+        slice = task->burst < QUANTUM ? task->burst : QUANTUM;
+        task->burst -= slice;
+        order = order * 31 + task->tid;
+        (*decisions)++;
+        if (task->burst > 0)
+            heapPush(&ready, task);
+    }
+    heapFree(&ready);
+    return order;
+}
+
+static unsigned long listSchedule(Task *tasks, int n, long *decisions) {
+    struct node *head = NULL, *temp;
+    unsigned long order = 0;
+    Task *task;
+    int i, slice;
+
+    for (i = 0; i < n; i++)
+        insert(&head, &tasks[i]);
+    while (head != NULL) {
+        // earliest deadline, none (0) last and ties by tid as in the heap
+        task = head->task;
+        for (temp = head->next; temp != NULL; temp = temp->next)
+            if ((temp->task->deadline == 0) != (task->deadline == 0) ? task->deadline == 0 :
+                temp->task->deadline < task->deadline ||
+                (temp->task->deadline == task->deadline && temp->task->tid < task->tid))
+                task = temp->task;
+
+        slice = task->burst < QUANTUM ? task->burst : QUANTUM;
+        task->burst -= slice;
+        order = order * 31 + task->tid;
+        (*decisions)++;
+        if (task->burst <= 0)
+            delete(&head, task);
+    }
+    return order;
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[16] = { 1000, 10000, 30000, 100000 }, count = 4, listMax = 30000, k, n, opt;
+    char (*names)[16];
+    Task *tasks;
+    unsigned long heapOrder, listOrder;
+    long decisions;
+    double t0, heapTime, listTime;
+
+    while ((opt = getopt(argc, argv, "l:")) != -1)
+        switch (opt) {
+        case 'l': listMax = atoi(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-l list-max] [tasks...]\n", argv[0]);
+            return 1;
+        }
+    if (optind < argc)
+        for (count = 0; count < 16 && optind + count < argc; count++)
+            sizes[count] = atoi(argv[optind + count]);
+
+    printf("%10s %12s %12s %12s %8s\n", "tasks", "decisions", "heap s", "list s", "speedup");
+    for (k = 0; k < count; k++) {
+        n = sizes[k];
+        names = malloc(n * sizeof(*names));
+
+        tasks = generate(n, names);
+        decisions = 0;
+        t0 = seconds();
+        heapOrder = heapSchedule(tasks, n, &decisions);
+        heapTime = seconds() - t0;
+        free(tasks);
+
+        if (n > listMax) {
+            printf("%10d %12ld %12.4f %12s %8s\n", n, decisions, heapTime, "-", "-");
+            free(names);
+            continue;
+        }
+        tasks = generate(n, names);
+        decisions = 0;
+        t0 = seconds();
+        listOrder = listSchedule(tasks, n, &decisions);
+        listTime = seconds() - t0;
+        free(tasks);
+
+        printf("%10d %12ld %12.4f %12.4f %8.1f%s\n", n, decisions, heapTime, listTime,
+               listTime / heapTime, heapOrder == listOrder ? "" : "  ORDER DIFFERS");
+        free(names);
+    }
+    return 0;
+}
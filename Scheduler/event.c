@@ -0,0 +1,68 @@
+/**
+ * Event queue of the simulation.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "event.h"
+
+static int earlier(Event *a, Event *b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+void eventPush(EventQueue *queue, long time, int type, int cpu, Task *task) {
+    Event event;
+    int i;
+
+    if (queue->size == queue->capacity) {
+        queue->capacity = queue->capacity ? 2 * queue->capacity : 256;
+        queue->event = realloc(queue->event, queue->capacity * sizeof(Event));
+        if (queue->event == NULL) {
+            fprintf(stderr, "out of memory growing the event queue\n");
+            exit(1);
+        }
+    }
+
+    event.time = time;
+    event.seq = queue->pushed++;
+    event.type = type;
+    event.cpu = cpu;
+    event.task = task;
+
+    // sift up
+    for (i = queue->size++; i > 0 && earlier(&event, &queue->event[(i - 1) / 2]); i = (i - 1) / 2)
+        queue->event[i] = queue->event[(i - 1) / 2];
+    queue->event[i] = event;
+}
+
+int eventPop(EventQueue *queue, Event *event) {
+    Event last;
+    int i, child;
+
+    if (queue->size == 0)
+        return 0;
+    *event = queue->event[0];
+    last = queue->event[--queue->size];
+
+    // sift the last event down from the root
+    for (i = 0; (child = 2 * i + 1) < queue->size; i = child) {
+        if (child + 1 < queue->size && earlier(&queue->event[child + 1], &queue->event[child]))
+            child++;
+        if (!earlier(&queue->event[child], &last))
+            break;
+        queue->event[i] = queue->event[child];
+    }
+    queue->event[i] = last;
+    return 1;
+}
+
+long eventNextTime(EventQueue *queue) {
+    return queue->size > 0 ? queue->event[0].time : -1;
+}
+
+void eventFree(EventQueue *queue) {
+    free(queue->event);
+    queue->event = NULL;
+    queue->size = queue->capacity = 0;
+}
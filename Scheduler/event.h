@@ -0,0 +1,35 @@
+/**
+ * Events of the simulation, in a binary min-heap on their time. Events
+ * at the same time come out in the order they were pushed.
+ */
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "task.h"
+
+#define EVENT_ARRIVAL   0    // task enters the system
+#define EVENT_IO_DONE   1    // task's I/O burst is over
+#define EVENT_SLICE_END 2    // the CPU is done with the task's slice
+
+typedef struct {
+    long time;
+    long seq;
+    int type;
+    int cpu;
+    Task *task;
+} Event;
+
+typedef struct {
+    Event *event;
+    int size;
+    int capacity;
+    long pushed;
+} EventQueue;
+
+void eventPush(EventQueue *queue, long time, int type, int cpu, Task *task);
+int eventPop(EventQueue *queue, Event *event);      // 0 when empty
+long eventNextTime(EventQueue *queue);              // -1 when empty
+void eventFree(EventQueue *queue);
+
+#endif
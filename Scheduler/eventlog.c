@@ -0,0 +1,91 @@
+/**
+ * Event log writer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "eventlog.h"
+
+EventLog *logOpen(const char *path, const Task *tasks, int n, int cpus, const char *policy) {
+    EventLog *log;
+    char name[LOG_POLICY_SIZE] = { 0 }, padding[8] = { 0 };
+    int32_t header[2] = { n, cpus };
+    uint64_t namesSize = 0;
+    int i, ok;
+
+    if ((log = calloc(1, sizeof(EventLog))) == NULL ||
+        (log->ring = malloc(LOG_RING * sizeof(LogRecord))) == NULL) {
+        fprintf(stderr, "out of memory for the event log\n");
+        free(log);
+        return NULL;
+    }
+    if ((log->out = fopen(path, "wb")) == NULL) {
+        perror(path);
+        free(log->ring);
+        free(log);
+        return NULL;
+    }
+    log->path = path;
+
+    snprintf(name, LOG_POLICY_SIZE, "%s", policy);
+    for (i = 0; i < n; i++)
+        namesSize += strlen(tasks[i].name) + 1;
+    namesSize += -(LOG_HEADER_SIZE + namesSize) & 7;
+    ok = fwrite(LOG_MAGIC, 4, 1, log->out) == 1 && fwrite(header, sizeof(header), 1, log->out) == 1 &&
+         fwrite(name, LOG_POLICY_SIZE, 1, log->out) == 1 &&
+         fwrite(&namesSize, sizeof(namesSize), 1, log->out) == 1;
+    for (i = 0; ok && i < n; i++) {
+        ok = fwrite(tasks[i].name, strlen(tasks[i].name) + 1, 1, log->out) == 1;
+        namesSize -= strlen(tasks[i].name) + 1;
+    }
+    if (ok && namesSize > 0)
+        ok = fwrite(padding, namesSize, 1, log->out) == 1;
+    log->failed = !ok;
+    return log;
+}
+
+void logFlush(EventLog *log) {
+    uint64_t head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE), tail = log->tail;
+    size_t from, count;
+
+    // at most two runs: up to the end of the ring, then from its start
+    while (tail != head) {
+        from = tail & (LOG_RING - 1);
+        count = head - tail < LOG_RING - from ? head - tail : LOG_RING - from;
+        if (!log->failed && fwrite(&log->ring[from], sizeof(LogRecord), count, log->out) != count)
+            log->failed = 1;
+        tail += count;
+        __atomic_store_n(&log->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+void logEvent(EventLog *log, long time, int type, int cpu, int task, int value) {
+    LogRecord *record;
+
+    if (log->head - __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE) == LOG_RING)
+        logFlush(log);
+    record = &log->ring[log->head & (LOG_RING - 1)];
+    record->time = time;
+    record->type = type;
+    record->cpu = cpu;
+    record->task = task;
+    record->value = value;
+    __atomic_store_n(&log->head, log->head + 1, __ATOMIC_RELEASE);
+    log->records++;
+}
+
+int logClose(EventLog *log) {
+    int failed;
+
+    logFlush(log);
+    failed = fclose(log->out) != 0 || log->failed;
+    if (failed)
+        fprintf(stderr, "%s: write failed\n", log->path);
+    free(log->ring);
+    free(log);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * Binary log of what a simulation did, for timelines (see timeline.c).
+ *
+ * Every record is 24 bytes, little endian like traces:
+ *
+ *  time (64 bit), type, CPU, task (its tid), value (32 bit each)
+ *
+ * after the header
+ *
+ *  "EVL1" count cpus   count the tasks, 32 bit integers
+ *  policy              16 bytes, NUL padded
+ *  namesSize           64 bit
+ *  namesSize bytes     the names of the tasks in tid order, each ended by a NUL,
+ *                      padded with NULs for the records to start 8 byte aligned
+ *
+ * Records go to a ring in memory, and from there to the file a chunk at a
+ * time. The ring has one writer, which only moves head, and one reader,
+ * which only moves tail, so a thread could drain it without a lock; here
+ * the simulation drains it itself when it is full, and on logClose.
+ */
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "task.h"
+
+#define LOG_MAGIC "EVL1"
+#define LOG_POLICY_SIZE 16
+#define LOG_HEADER_SIZE 36  // up to the names
+
+// types of the records, with what their value is
+#define LOG_SWITCH      0   // the CPU starts a slice of the task, value its length
+#define LOG_PREEMPT     1   // the slice ended, the task is ready again; value the CPU time left
+#define LOG_BLOCK       2   // the slice ended in an I/O burst, value its length
+#define LOG_COMPLETE    3   // the task completed, value its turnaround
+#define LOG_MISS        4   // it completed past its deadline, value how late
+
+#define LOG_RING        (1 << 16)   // records, a power of two
+
+typedef struct {
+    int64_t time;
+    int32_t type;
+    int32_t cpu;
+    int32_t task;
+    int32_t value;
+} LogRecord;
+
+typedef struct {
+    FILE *out;
+    const char *path;
+    LogRecord *ring;
+    uint64_t head;      // next record written, only moved by the writer
+    uint64_t tail;      // next record drained, only moved by the reader
+    long records;       // written in all
+    int failed;         // a write failed
+} EventLog;
+
+// create the log and write its header; NULL after printing why
+EventLog *logOpen(const char *path, const Task *tasks, int n, int cpus, const char *policy);
+
+// write what is in the ring out to the file
+void logFlush(EventLog *log);
+
+// flush and close; 0, or -1 after printing why when a write failed
+int logClose(EventLog *log);
+
+// append a record to the ring, draining it first when it is full
+void logEvent(EventLog *log, long time, int type, int cpu, int task, int value);
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * Pick-next cost and fairness of the time sharing policies.
+ *
+ * n CPU bound tasks, of priorities 1 to 10 in turn, are all ready. Each
+ * policy then makes 20 n scheduling decisions (pick the next task, give
+ * it its slice, account for it and put it back) through its Policy
+ * functions, without the simulator. For each policy and n are printed the
+ * time per decision and Jain's fairness index (1 when fair, down to 1/n
+ * when one task gets everything) of the CPU time the tasks got, plain
+ * and divided by their CFS weight (fair in proportion to priority).
+ *
+ *  fair_bench [tasks...]    default 1000 10000 100000 1000000
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "task.h"
+#include "policy.h"
+
+#define ROUNDS 20
+
+static const char *names[] = { "rr", "rr_p", "mlfq", "cfs", NULL };
+
+static double seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// (sum x)^2 / (n sum x^2)
+static double jain(double *x, int n) {
+    double sum = 0, squares = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        sum += x[i];
+        squares += x[i] * x[i];
+    }
+    return squares > 0 ? sum * sum / (n * squares) : 1.0;
+}
+
+// decisions per second; the CPU time each task got in got
+static double schedule(const Policy *policy, Task *tasks, int n, double *got) {
+    void *rq = policy->init();
+    long decisions = (long) ROUNDS * n, d;
+    double t0;
+    Task *task;
+    int i, slice;
+
+    memset(tasks, 0, n * sizeof(Task));
+    for (i = 0; i < n; i++) {
+        tasks[i].name = "T";
+        tasks[i].tid = i;
+        tasks[i].priority = MIN_PRIORITY + i % (MAX_PRIORITY - MIN_PRIORITY + 1);
+        tasks[i].burst = tasks[i].remaining = 1 << 30;
+        tasks[i].heapIndex = tasks[i].cpu = -1;
+        got[i] = 0;
+        policy->enqueue(rq, &tasks[i]);
+    }
+
+    t0 = seconds();
+    for (d = 0; d < decisions; d++) {
+        task = policy->pick_next(rq);
+        slice = policy->slice(rq, task);
+        task->slice = slice;
+        got[task->tid] += slice;
+        if (policy->tick != NULL)
+            policy->tick(rq, task, slice);
+        policy->enqueue(rq, task);
+    }
+    t0 = seconds() - t0;
+
+    policy->destroy(rq);
+    return decisions / t0;
+}
+
+int main(int argc, char *argv[]) {
+    int sizes[16] = { 1000, 10000, 100000, 1000000 }, count = 4, k, p, i, n;
+    double *got, rate, plain;
+    Task *tasks;
+
+    if (argc > 1)
+        for (count = 0; count < 16 && count + 1 < argc; count++)
+            sizes[count] = atoi(argv[count + 1]);
+
+    printf("%-6s %10s %12s %12s %10s %10s\n", "policy", "tasks", "decisions", "ns/decision",
+           "jain", "jain/wt");
+    for (k = 0; k < count; k++) {
+        n = sizes[k];
+        tasks = malloc(n * sizeof(Task));
+        got = malloc(n * sizeof(double));
+        if (tasks == NULL || got == NULL) {
+            fprintf(stderr, "out of memory for %d tasks\n", n);
+            return 1;
+        }
+
+        for (p = 0; names[p] != NULL; p++) {
+            rate = schedule(findPolicy(names[p]), tasks, n, got);
+            plain = jain(got, n);
+            for (i = 0; i < n; i++)
+                got[i] /= cfsWeight(tasks[i].priority);
+            printf("%-6s %10d %12ld %12.1f %10.4f %10.4f\n", names[p], n, (long) ROUNDS * n,
+                   1e9 / rate, plain, jain(got, n));
+        }
+        free(tasks);
+        free(got);
+    }
+    return 0;
+}
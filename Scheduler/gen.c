@@ -0,0 +1,325 @@
+/**
+ * Workload generator: writes a schedule for driver.c.
+ *
+ * Aperiodic tasks arrive as a Poisson process, or in batches (bursty) of
+ * geometric size around the same mean rate, with exponential or Pareto
+ * (heavy tailed) CPU bursts. The rate is set from the utilisation target:
+ * utilisation x cpus / mean burst tasks per time unit. Their priorities
+ * are drawn from a mix of weights, and they get a deadline of slack times
+ * their burst after arrival when a slack is given.
+ *
+ * Periodic real-time tasks, with log-uniform periods and utilisations
+ * drawn by UUniFast to sum to their own target, add one job per period up
+ * to the last aperiodic arrival (or the horizon when there is none), due
+ * at the end of the period, or a deadline drawn between ratio times the
+ * period and the period, with rate monotonic priorities.
+ *
+ * The same options and seed always give the same trace.
+ *
+ * usage: gen [-n tasks] [-s seed] [-a poisson|bursty] [-g batch] [-b exp|pareto] [-m mean burst]
+ *            [-k shape] [-U utilisation] [-c cpus] [-p priority:weight,...] [-d slack]
+ *            [-T periodic[,min period,max period]] [-u utilisation] [-H horizon]
+ *            [-r ratio] [-i interval,time] [-A | -B] [-o file]
+ *
+ * defaults: 1000 tasks, seed 1, Poisson arrivals, exponential bursts of
+ * mean 20 (Pareto shape 1.5), utilisation 0.8 on 1 CPU, priorities 1 to
+ * 10 equally likely, no deadlines; periodic tasks have periods in
+ * [10, 1000] and utilisation 0.3 in all, horizon 10000. -i gives every
+ * aperiodic task an I/O burst of time after each interval of CPU time.
+ * -B writes a binary trace (see trace.h), which needs -o. -A writes the
+ * periodic tasks themselves, as the lines
+ *
+ *  [name], [cost], [period], [deadline]
+ *
+ * read by analyse.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "task.h"
+#include "policy.h"
+#include "trace.h"
+
+#define NAME_SIZE 24
+
+typedef struct {
+    int index;          // generation order, breaks ties of arrival
+    Task task;
+} Job;
+
+static unsigned long long state;
+
+// xorshift64*, so that a seed gives the same trace everywhere
+static double uniform(void) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ULL >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double exponential(double mean) {
+    return -mean * log(uniform());
+}
+
+// Pareto of the given mean and shape (> 1): scale mean (shape - 1) / shape
+static double pareto(double mean, double shape) {
+    return mean * (shape - 1) / shape / pow(uniform(), 1 / shape);
+}
+
+// priority:weight,... into weight[MIN_PRIORITY..MAX_PRIORITY]; 0 when malformed
+static int parseMix(char *text, double *weight) {
+    char *item;
+    int p, any = 0;
+
+    memset(weight, 0, (MAX_PRIORITY + 1) * sizeof(double));
+    while ((item = strsep(&text, ",")) != NULL) {
+        p = atoi(item);
+        if (p < MIN_PRIORITY || p > MAX_PRIORITY || strchr(item, ':') == NULL ||
+            (weight[p] = atof(strchr(item, ':') + 1)) < 0)
+            return 0;
+        any |= weight[p] > 0;
+    }
+    return any;
+}
+
+static int drawPriority(double *weight) {
+    double total = 0, x;
+    int p;
+
+    for (p = MIN_PRIORITY; p <= MAX_PRIORITY; p++)
+        total += weight[p];
+    x = uniform() * total;
+    for (p = MIN_PRIORITY; p < MAX_PRIORITY; p++)
+        if ((x -= weight[p]) < 0)
+            break;
+    return p;
+}
+
+static int byArrival(const void *a, const void *b) {
+    const Job *x = a, *y = b;
+
+    return x->task.arrival != y->task.arrival ? (x->task.arrival < y->task.arrival ? -1 : 1) :
+           x->index - y->index;
+}
+
+static int byPeriod(const void *a, const void *b) {
+    return *(const int *) a - *(const int *) b;
+}
+
+int main(int argc, char *argv[])
+{
+    int n = 1000, batch = 8, heavy = 0, bursty = 0, binary = 0, cpus = 1, periodic = 0;
+    int minPeriod = 10, maxPeriod = 1000, horizon = 10000, ioInterval = 0, ioTime = 0;
+    double meanBurst = 20, shape = 1.5, utilisation = 0.8, rtUtilisation = 0.3, slack = 0, ratio = 1;
+    double weight[MAX_PRIORITY + 1], rate, t = 0, sum, next;
+    const char *outName = NULL;
+    int *period, *cost, *deadline, opt, i, j, k, count, left = 0, jobs, last, p, error = 0, taskset = 0;
+    char *names;
+    Job *job;
+    Trace trace;
+    FILE *out = stdout;
+
+    state = 1;
+    for (p = MIN_PRIORITY; p <= MAX_PRIORITY; p++)
+        weight[p] = 1;
+    weight[0] = 0;
+
+    while ((opt = getopt(argc, argv, "n:s:a:g:b:m:k:U:c:p:d:T:u:H:r:i:ABo:")) != -1)
+        switch (opt) {
+        case 'n': n = atoi(optarg); break;
+        case 's': state = strtoull(optarg, NULL, 10) * 2 + 1; break;
+        case 'a':
+            bursty = strcmp(optarg, "bursty") == 0;
+            error |= !bursty && strcmp(optarg, "poisson") != 0;
+            break;
+        case 'g': batch = atoi(optarg); break;
+        case 'b':
+            heavy = strcmp(optarg, "pareto") == 0;
+            error |= !heavy && strcmp(optarg, "exp") != 0;
+            break;
+        case 'm': meanBurst = atof(optarg); break;
+        case 'k': shape = atof(optarg); break;
+        case 'U': utilisation = atof(optarg); break;
+        case 'c': cpus = atoi(optarg); break;
+        case 'p': error |= !parseMix(optarg, weight); break;
+        case 'd': slack = atof(optarg); break;
+        case 'T': error |= sscanf(optarg, "%d,%d,%d", &periodic, &minPeriod, &maxPeriod) < 1; break;
+        case 'u': rtUtilisation = atof(optarg); break;
+        case 'H': horizon = atoi(optarg); break;
+        case 'i': error |= sscanf(optarg, "%d,%d", &ioInterval, &ioTime) != 2; break;
+        case 'r': ratio = atof(optarg); break;
+        case 'A': taskset = 1; break;
+        case 'B': binary = 1; break;
+        case 'o': outName = optarg; break;
+        default: error = 1; break;
+        }
+
+    if (error || optind != argc || n < 0 || batch < 1 || meanBurst < 1 || shape <= 1 ||
+        utilisation <= 0 || cpus < 1 || slack < 0 || periodic < 0 || minPeriod < 1 ||
+        maxPeriod < minPeriod || rtUtilisation < 0 || horizon < 1 || ratio <= 0 || ratio > 1 ||
+        ioInterval < 0 || ioTime < 0 || (binary && (outName == NULL || taskset))) {
+        fprintf(stderr, "usage: %s [-n tasks] [-s seed] [-a poisson|bursty] [-g batch] [-b exp|pareto]\n"
+                "          [-m mean burst] [-k shape] [-U utilisation] [-c cpus] [-p priority:weight,...]\n"
+                "          [-d slack] [-T periodic[,min period,max period]] [-u utilisation] [-H horizon]\n"
+                "          [-r ratio] [-i interval,time] [-A | -B] [-o file]\n", argv[0]);
+        return 1;
+    }
+
+    // ---- periodic tasks: periods, then UUniFast utilisations as costs ----
+
+    period = malloc((periodic + 1) * sizeof(int));
+    cost = malloc((periodic + 1) * sizeof(int));
+    deadline = malloc((periodic + 1) * sizeof(int));
+    if (period == NULL || cost == NULL || deadline == NULL) {
+        fprintf(stderr, "out of memory for %d periodic tasks\n", periodic);
+        return 1;
+    }
+    for (k = 0; k < periodic; k++)
+        period[k] = (int) (minPeriod * exp(uniform() * log((double) maxPeriod / minPeriod)));
+    qsort(period, periodic, sizeof(int), byPeriod);
+    for (k = 0, sum = rtUtilisation; k < periodic; k++) {
+        next = k < periodic - 1 ? sum * pow(uniform(), 1.0 / (periodic - 1 - k)) : 0;
+        cost[k] = (int) ((sum - next) * period[k] + 0.5);
+        if (cost[k] < 1)
+            cost[k] = 1;
+        sum = next;
+    }
+    for (k = 0; k < periodic; k++) {
+        deadline[k] = ratio < 1 ? (int) (period[k] * (ratio + (1 - ratio) * uniform())) : period[k];
+        if (deadline[k] < cost[k])
+            deadline[k] = cost[k];
+    }
+
+    if (taskset) {
+        if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+            perror(outName);
+            return 1;
+        }
+        for (k = 0; k < periodic; k++)
+            fprintf(out, "P%d, %d, %d, %d\n", k + 1, cost[k], period[k], deadline[k]);
+        if (out != stdout && fclose(out) != 0) {
+            perror(outName);
+            return 1;
+        }
+        return 0;
+    }
+
+    // ---- aperiodic tasks ----
+
+    rate = utilisation * cpus / meanBurst;
+    count = n;
+    jobs = 0;
+    job = malloc((n > 0 ? n : 1) * sizeof(Job));
+    names = malloc((size_t) (n > 0 ? n : 1) * NAME_SIZE);
+    if (job == NULL || names == NULL) {
+        fprintf(stderr, "out of memory for %d tasks\n", n);
+        return 1;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (!bursty)
+            t += exponential(1 / rate);
+        else if (left-- == 0) {
+            // a new batch: batches come at rate / batch, their size is geometric of mean batch
+            t += exponential(batch / rate);
+            left = batch == 1 ? 0 : (int) (log(uniform()) / log(1 - 1.0 / batch));
+        }
+
+        snprintf(names + (size_t) jobs * NAME_SIZE, NAME_SIZE, "T%d", i + 1);
+        memset(&job[jobs], 0, sizeof(Job));
+        job[jobs].index = jobs;
+        job[jobs].task.priority = drawPriority(weight);
+        job[jobs].task.burst = (int) ((heavy ? pareto(meanBurst, shape) : exponential(meanBurst)) + 0.5);
+        if (job[jobs].task.burst < 1)
+            job[jobs].task.burst = 1;
+        job[jobs].task.arrival = (int) t;
+        if (slack > 0)
+            job[jobs].task.deadline = job[jobs].task.arrival + (int) ceil(slack * job[jobs].task.burst);
+        job[jobs].task.ioInterval = ioInterval;
+        job[jobs].task.ioTime = ioTime;
+        jobs++;
+    }
+
+    // ---- jobs of the periodic tasks up to the last arrival ----
+
+    last = n > 0 ? (int) t : horizon;
+    for (k = 0; k < periodic; k++)
+        count += last / period[k] + 1;
+    if (count > n) {
+        job = realloc(job, count * sizeof(Job));
+        names = realloc(names, (size_t) count * NAME_SIZE);
+        if (job == NULL || names == NULL) {
+            fprintf(stderr, "out of memory for %d jobs\n", count);
+            return 1;
+        }
+    }
+
+    for (k = 0; k < periodic; k++)
+        for (j = 0; j * period[k] <= last; j++) {
+            snprintf(names + (size_t) jobs * NAME_SIZE, NAME_SIZE, "P%d.%d", k + 1, j + 1);
+            memset(&job[jobs], 0, sizeof(Job));
+            job[jobs].index = jobs;
+            // rate monotonic: the shortest period gets the highest priority
+            job[jobs].task.priority = periodic == 1 ? MAX_PRIORITY :
+                MAX_PRIORITY - k * (MAX_PRIORITY - MIN_PRIORITY) / (periodic - 1);
+            job[jobs].task.burst = cost[k];
+            job[jobs].task.arrival = j * period[k];
+            job[jobs].task.deadline = j * period[k] + deadline[k];
+            jobs++;
+        }
+
+    // ---- in arrival order, each job's name in the slot of its index ----
+
+    for (i = 0; i < jobs; i++)
+        job[i].task.name = names + (size_t) job[i].index * NAME_SIZE;
+    qsort(job, jobs, sizeof(Job), byArrival);
+
+    if (binary) {
+        // an arena of the names in order, as the loader would make it
+        trace.n = jobs;
+        trace.tasks = malloc((jobs > 0 ? jobs : 1) * sizeof(Task));
+        trace.names = malloc((size_t) (jobs > 0 ? jobs : 1) * NAME_SIZE);
+        trace.namesSize = 0;
+        if (trace.tasks == NULL || trace.names == NULL) {
+            fprintf(stderr, "out of memory for %d jobs\n", jobs);
+            return 1;
+        }
+        for (i = 0; i < jobs; i++) {
+            trace.tasks[i] = job[i].task;
+            trace.tasks[i].tid = i;
+            trace.tasks[i].name = strcpy(trace.names + trace.namesSize, job[i].task.name);
+            trace.namesSize += strlen(job[i].task.name) + 1;
+        }
+        error = saveTrace(outName, &trace) < 0;
+        free(trace.tasks);
+        free(trace.names);
+    }
+    else {
+        if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+            perror(outName);
+            return 1;
+        }
+        for (i = 0; i < jobs; i++) {
+            fprintf(out, "%s, %d, %d, %d, %d", job[i].task.name, job[i].task.priority,
+                    job[i].task.burst, job[i].task.deadline, job[i].task.arrival);
+            if (job[i].task.ioInterval > 0)
+                fprintf(out, ", %d, %d", job[i].task.ioInterval, job[i].task.ioTime);
+            fprintf(out, "\n");
+        }
+        if (out != stdout && fclose(out) != 0) {
+            perror(outName);
+            error = 1;
+        }
+    }
+
+    free(job);
+    free(names);
+    free(period);
+    free(cost);
+    free(deadline);
+    return error;
+}
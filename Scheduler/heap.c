@@ -0,0 +1,96 @@
+/**
+ * Binary min-heap of tasks.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "heap.h"
+#include "task.h"
+
+// a deadline of 0 is none: such tasks come after all those that have one
+static int earlierDeadline(Task *a, Task *b) {
+    if ((a->deadline == 0) != (b->deadline == 0))
+        return b->deadline == 0;
+    return a->deadline < b->deadline || (a->deadline == b->deadline && a->tid < b->tid);
+}
+
+static int before(TaskHeap *heap, Task *a, Task *b) {
+    return heap->before != NULL ? heap->before(a, b) : earlierDeadline(a, b);
+}
+
+static void place(TaskHeap *heap, int i, Task *task) {
+    heap->task[i] = task;
+    task->heapIndex = i;
+}
+
+// move the task at i towards the root while it is earlier than its parent
+static void siftUp(TaskHeap *heap, int i) {
+    Task *task = heap->task[i];
+
+    while (i > 0 && before(heap, task, heap->task[(i - 1) / 2])) {
+        place(heap, i, heap->task[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    place(heap, i, task);
+}
+
+// move the task at i towards the leaves while a child is earlier
+static void siftDown(TaskHeap *heap, int i) {
+    Task *task = heap->task[i];
+    int child;
+
+    while ((child = 2 * i + 1) < heap->size) {
+        if (child + 1 < heap->size && before(heap, heap->task[child + 1], heap->task[child]))
+            child++;
+        if (!before(heap, heap->task[child], task))
+            break;
+        place(heap, i, heap->task[child]);
+        i = child;
+    }
+    place(heap, i, task);
+}
+
+void heapPush(TaskHeap *heap, Task *task) {
+    if (heap->size == heap->capacity) {
+        heap->capacity = heap->capacity ? 2 * heap->capacity : 64;
+        heap->task = realloc(heap->task, heap->capacity * sizeof(Task *));
+        if (heap->task == NULL) {
+            fprintf(stderr, "out of memory growing the heap\n");
+            exit(1);
+        }
+    }
+    heap->task[heap->size] = task;
+    siftUp(heap, heap->size++);
+}
+
+Task *heapTop(TaskHeap *heap) {
+    return heap->size > 0 ? heap->task[0] : NULL;
+}
+
+Task *heapPop(TaskHeap *heap) {
+    Task *first = heapTop(heap);
+
+    if (first != NULL)
+        heapRemove(heap, first);
+    return first;
+}
+
+void heapRemove(TaskHeap *heap, Task *task) {
+    int i = task->heapIndex;
+
+    task->heapIndex = -1;
+    if (i == --heap->size)
+        return;
+    place(heap, i, heap->task[heap->size]);
+    if (i > 0 && before(heap, heap->task[i], heap->task[(i - 1) / 2]))
+        siftUp(heap, i);
+    else
+        siftDown(heap, i);
+}
+
+void heapFree(TaskHeap *heap) {
+    free(heap->task);
+    heap->task = NULL;
+    heap->size = heap->capacity = 0;
+}
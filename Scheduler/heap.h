@@ -0,0 +1,28 @@
+/**
+ * Binary min-heap of tasks, ordered by deadline (ties by tid) unless the
+ * heap is given another order in before.
+ *
+ * The heap is intrusive: every task keeps its slot in heapIndex, so a
+ * task can be removed or re-keyed in O(log n) without searching for it.
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include "task.h"
+
+typedef struct {
+    Task **task;
+    int size;
+    int capacity;
+    int (*before)(Task *a, Task *b);   // a comes out first; NULL for deadline order
+} TaskHeap;
+
+// insert, remove the first task, look at it, and remove any task
+void heapPush(TaskHeap *heap, Task *task);
+Task *heapPop(TaskHeap *heap);
+Task *heapTop(TaskHeap *heap);
+void heapRemove(TaskHeap *heap, Task *task);
+void heapFree(TaskHeap *heap);
+
+#endif
@@ -7,13 +7,22 @@
 #include <string.h>
 
 #include "list.h"
+#include "slab.h"
 #include "task.h"
 
+#define NODES_PER_CHUNK 1024
+
+static Slab nodes;
+
 
 // add a new task to the list of tasks
 void insert(struct node **head, Task *newTask) {
     // add the new task to the list 
-    struct node *newNode = malloc(sizeof(struct node));
+    struct node *newNode;
+
+    if (nodes.size == 0)
+        slabInit(&nodes, sizeof(struct node), NODES_PER_CHUNK);
+    newNode = slabAlloc(&nodes);
 
     newNode->task = newTask;
     newNode->next = *head;
@@ -27,20 +36,21 @@ void delete(struct node **head, Task *task) {
 
     temp = *head;
     // special case - beginning of list
-    if (strcmp(task->name,temp->task->name) == 0) {
+    if (temp->task == task) {
         *head = (*head)->next;
     }
     else {
         // interior or last element in the list
         prev = *head;
         temp = temp->next;
-        while (strcmp(task->name,temp->task->name) != 0) {
+        while (temp->task != task) {
             prev = temp;
             temp = temp->next;
         }
 
         prev->next = temp->next;
     }
+    slabFree(&nodes, temp);
 }
 
 // traverse the list
@@ -53,3 +63,13 @@ void traverse(struct node *head) {
         temp = temp->next;
     }
 }
+
+// delete every node of the list
+void freeList(struct node **head) {
+    struct node *temp;
+
+    while ((temp = *head) != NULL) {
+        *head = temp->next;
+        slabFree(&nodes, temp);
+    }
+}
@@ -1,5 +1,7 @@
 /**
  * list data structure containing the tasks in the system
+ *
+ * The nodes come from a slab and go back to it when deleted.
  */
 
 #include "task.h"
@@ -13,3 +15,4 @@ struct node {
 void insert(struct node **head, Task *task);
 void delete(struct node **head, Task *task);
 void traverse(struct node *head);
+void freeList(struct node **head);
@@ -0,0 +1,31 @@
+/**
+ * Registry of the scheduling policies.
+ */
+
+#include <string.h>
+
+#include "policy.h"
+
+extern const Policy fcfsPolicy, sjfPolicy, priorityPolicy, rrPolicy, rrPriorityPolicy, edfPolicy,
+    mlfqPolicy, cfsPolicy;
+
+const Policy *policies[] = {
+    &fcfsPolicy,
+    &sjfPolicy,
+    &priorityPolicy,
+    &rrPolicy,
+    &rrPriorityPolicy,
+    &edfPolicy,
+    &mlfqPolicy,
+    &cfsPolicy,
+    NULL
+};
+
+const Policy *findPolicy(const char *name) {
+    int i;
+
+    for (i = 0; policies[i] != NULL; i++)
+        if (strcmp(policies[i]->name, name) == 0)
+            return policies[i];
+    return NULL;
+}
@@ -0,0 +1,50 @@
+/**
+ * Scheduling policies.
+ *
+ * A policy owns its ready queue. The virtual CPU (CPU.c) asks it for the
+ * next task, runs that task for the slice the policy gives and hands it
+ * back with enqueue until it completes. Policies are registered by name,
+ * so one binary can select any of them at run time, or run them all over
+ * the same trace.
+ */
+
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "task.h"
+
+#define MIN_PRIORITY 1
+#define MAX_PRIORITY 10
+
+// MLFQ: levels, the quantum of each (a task that uses it up moves one
+// level down), and the CPU time a queue serves between two boosts of all
+// its tasks back to the top level
+#define MLFQ_MAX_LEVELS 8
+extern int mlfqLevels;
+extern int mlfqQuantum[MLFQ_MAX_LEVELS];
+extern int mlfqBoost;
+
+// CFS: weight of a priority, from Linux's nice weights (priority 5 is nice 0)
+int cfsWeight(int priority);
+
+typedef struct policy {
+    const char *name;
+    const char *description;
+    void *(*init)(void);                          // a new, empty ready queue
+    void (*enqueue)(void *rq, Task *task);        // task is ready to run
+    Task *(*pick_next)(void *rq);                 // remove the task to run next, NULL when none
+    int (*slice)(void *rq, Task *task);           // time it may run before the policy is asked again
+    void (*tick)(void *rq, Task *task, int ran);  // task ran for ran units and isn't done (it is
+                                                  // enqueued again or does I/O), may be NULL
+    void (*on_complete)(void *rq, Task *task);    // task is done, may be NULL
+    void (*destroy)(void *rq);
+    Task *(*steal)(void *rq);                     // a task for another CPU, NULL to use pick_next
+} Policy;
+
+// all the policies, NULL terminated
+extern const Policy *policies[];
+
+// the policy called name, NULL when there is none
+const Policy *findPolicy(const char *name);
+
+#endif
@@ -0,0 +1,69 @@
+/**
+ * FIFO queue of tasks.
+ */
+
+#include <stdlib.h>
+
+#include "queue.h"
+#include "task.h"
+
+void queuePush(TaskQueue *queue, Task *task) {
+    task->next = NULL;
+    task->prev = queue->tail;
+    if (queue->tail != NULL)
+        queue->tail->next = task;
+    else
+        queue->head = task;
+    queue->tail = task;
+    queue->size++;
+}
+
+void queueRemove(TaskQueue *queue, Task *task) {
+    if (task->prev != NULL)
+        task->prev->next = task->next;
+    else
+        queue->head = task->next;
+    if (task->next != NULL)
+        task->next->prev = task->prev;
+    else
+        queue->tail = task->prev;
+    task->next = task->prev = NULL;
+    queue->size--;
+}
+
+Task *queuePop(TaskQueue *queue) {
+    Task *first = queue->head;
+
+    if (first != NULL)
+        queueRemove(queue, first);
+    return first;
+}
+
+Task *queuePopTail(TaskQueue *queue) {
+    Task *last = queue->tail;
+
+    if (last != NULL)
+        queueRemove(queue, last);
+    return last;
+}
+
+void queueAppend(TaskQueue *queue, TaskQueue *other) {
+    if (other->head == NULL)
+        return;
+    if (queue->tail != NULL) {
+        queue->tail->next = other->head;
+        other->head->prev = queue->tail;
+    }
+    else
+        queue->head = other->head;
+    queue->tail = other->tail;
+    queue->size += other->size;
+    other->head = other->tail = NULL;
+    other->size = 0;
+}
+
+// the tasks belong to their owner: only the queue is emptied
+void queueFree(TaskQueue *queue) {
+    queue->head = queue->tail = NULL;
+    queue->size = 0;
+}
@@ -0,0 +1,30 @@
+/**
+ * FIFO queue of tasks.
+ *
+ * The queue is intrusive: it links the tasks through their own next and
+ * prev fields, so joining or leaving it allocates nothing, and a task can
+ * be taken out of the middle in O(1). A task is in one queue at a time.
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "task.h"
+
+typedef struct {
+    Task *head;
+    Task *tail;
+    int size;
+} TaskQueue;
+
+// append at the tail, remove from the head or from the tail (NULL when empty)
+void queuePush(TaskQueue *queue, Task *task);
+Task *queuePop(TaskQueue *queue);
+Task *queuePopTail(TaskQueue *queue);
+void queueRemove(TaskQueue *queue, Task *task);
+
+// move all the tasks of other to the tail of queue, in O(1)
+void queueAppend(TaskQueue *queue, TaskQueue *other);
+void queueFree(TaskQueue *queue);
+
+#endif
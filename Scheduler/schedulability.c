@@ -0,0 +1,339 @@
+/**
+ * Schedulability analysis.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "schedulability.h"
+
+// slack for the floating point sums
+#define EPSILON 1e-9
+
+void taskSetInit(TaskSet *set) {
+    memset(set, 0, sizeof(TaskSet));
+    set->hyperbolic = 1;
+}
+
+void taskSetFree(TaskSet *set) {
+    free(set->task);
+    free(set->scratch);
+    taskSetInit(set);
+}
+
+static long window(const PeriodicTask *task) {
+    return task->deadline - task->jitter;
+}
+
+// deadline monotonic, on the window left after the jitter, then on the period
+static int higherPriority(const PeriodicTask *a, const PeriodicTask *b) {
+    return window(a) < window(b) || (window(a) == window(b) && a->period < b->period);
+}
+
+static void account(TaskSet *set, const PeriodicTask *task, int sign) {
+    double u = (double) task->cost / task->period;
+
+    set->utilisation += sign * u;
+    if (sign > 0)
+        set->hyperbolic *= u + 1;
+    else
+        set->hyperbolic /= u + 1;
+    set->density += sign * (double) task->cost / window(task);
+    set->constrained += sign * (task->deadline < task->period || task->jitter > 0);
+}
+
+// slot of task in priority order, after the tasks of equal priority
+static int position(const TaskSet *set, const PeriodicTask *task) {
+    int low = 0, high = set->n, middle;
+
+    while (low < high) {
+        middle = (low + high) / 2;
+        if (higherPriority(task, &set->task[middle]))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low;
+}
+
+static int insertAt(TaskSet *set, int p, const PeriodicTask *task) {
+    PeriodicTask *grown;
+    long *scratch;
+
+    if (set->n == set->capacity) {
+        set->capacity = set->capacity ? 2 * set->capacity : 64;
+        grown = realloc(set->task, set->capacity * sizeof(PeriodicTask));
+        scratch = realloc(set->scratch, 2 * set->capacity * sizeof(long));
+        if (grown != NULL)
+            set->task = grown;
+        if (scratch != NULL)
+            set->scratch = scratch;
+        if (grown == NULL || scratch == NULL) {
+            fprintf(stderr, "out of memory for %d periodic tasks\n", set->capacity);
+            exit(1);
+        }
+    }
+    memmove(&set->task[p + 1], &set->task[p], (set->n - p) * sizeof(PeriodicTask));
+    set->task[p] = *task;
+    set->task[p].response = -1;
+    set->task[p].least = 0;
+    set->n++;
+    account(set, task, 1);
+    return p;
+}
+
+static void removeAt(TaskSet *set, int p) {
+    account(set, &set->task[p], -1);
+    set->n--;
+    memmove(&set->task[p], &set->task[p + 1], (set->n - p) * sizeof(PeriodicTask));
+}
+
+static int valid(const PeriodicTask *task) {
+    return task->cost > 0 && task->period > 0 && task->jitter >= 0 &&
+           task->deadline <= task->period && task->cost <= window(task);
+}
+
+int taskSetAdd(TaskSet *set, const PeriodicTask *task) {
+    if (!valid(task))
+        return -1;
+    return insertAt(set, position(set, task), task);
+}
+
+
+// ---- fixed priority ----
+
+int liuLaylandTest(const TaskSet *set) {
+    return set->constrained == 0 &&
+           set->utilisation <= set->n * (pow(2.0, 1.0 / set->n) - 1) + EPSILON;
+}
+
+int hyperbolicTest(const TaskSet *set) {
+    return set->constrained == 0 && set->hyperbolic <= 2 + EPSILON;
+}
+
+// exact response time of task i from a lower bound r of it, -1 past D - J
+static long exactResponse(const TaskSet *set, int i, long r) {
+    const PeriodicTask *task = &set->task[i], *other;
+    long limit = window(task), next;
+    int j;
+
+    // from below, the iteration climbs to the least fixed point
+    for (;;) {
+        next = task->cost;
+        for (j = 0; j < i && next <= limit; j++) {
+            other = &set->task[j];
+            next += (r + other->jitter + other->period - 1) / other->period * other->cost;
+        }
+        if (next > limit)
+            return -1;
+        if (next == r)
+            return r;
+        r = next;
+    }
+}
+
+// what the tasks above task i add up to, going down the priorities
+typedef struct {
+    double utilisation;     // sum of U
+    double load;            // sum of C (1 - U) + U J
+    long least;             // lower bound of the response time of the task above
+} Above;
+
+// lower bound of the response time of task i: C / (1 - sum U') and that of the task above plus C (Davis et al., 2008)
+static long lowerBound(const TaskSet *set, int i, const Above *above) {
+    const PeriodicTask *task = &set->task[i];
+    long least = above->least + task->cost, r;
+
+    if (above->utilisation < 1) {
+        r = (long) ceil(task->cost / (1 - above->utilisation) - EPSILON);
+        if (r > least)
+            least = r;
+    }
+    return least;
+}
+
+// add task i, of lower bound least, to the tasks above the next one
+static void addAbove(const TaskSet *set, int i, long least, Above *above) {
+    const PeriodicTask *task = &set->task[i];
+    double u = (double) task->cost / task->period;
+
+    above->utilisation += u;
+    above->load += task->cost * (1 - u) + u * task->jitter;
+    above->least = least;
+}
+
+/*
+ * Response time of task i, -1 past its deadline, given the tasks above;
+ * *least is a lower bound of it, raised on return.
+ *
+ * (C + sum C'(1 - U') + U'J') / (1 - sum U') over the tasks above bounds
+ * the response time (Bini et al., 2009): when it is in time, it is used
+ * as is, in O(1). Otherwise the exact iteration starts from the largest
+ * lower bound known, which saves most of the iterations.
+ */
+static long responseTime(const TaskSet *set, int i, Above *above, long *least) {
+    const PeriodicTask *task = &set->task[i];
+    double bound = INFINITY;
+    long r = lowerBound(set, i, above);
+
+    if (r > *least)
+        *least = r;
+    if (above->utilisation < 1)
+        bound = (task->cost + above->load) / (1 - above->utilisation);
+    if (*least > window(task))
+        r = -1;
+    else if (bound <= window(task))
+        r = (long) ceil(bound - EPSILON);
+    else if ((r = exactResponse(set, i, *least)) >= 0)
+        *least = r;
+    addAbove(set, i, *least, above);
+    return r;
+}
+
+int responseTimeTest(TaskSet *set) {
+    Above above = { 0, 0, 0 };
+    int i, result = SCHEDULABLE;
+
+    for (i = 0; i < set->n; i++)
+        if ((set->task[i].response = responseTime(set, i, &above, &set->task[i].least)) < 0)
+            result = NOT_SCHEDULABLE;
+    return result;
+}
+
+long exactResponseTime(const TaskSet *set, int i) {
+    const PeriodicTask *task = &set->task[i];
+
+    return exactResponse(set, i, task->least > task->cost ? task->least : task->cost);
+}
+
+int admitFixedPriority(TaskSet *set, const PeriodicTask *task) {
+    Above above = { 0, 0, 0 };
+    long *least;
+    int p, i;
+
+    if (!valid(task) || set->utilisation + (double) task->cost / task->period > 1 + EPSILON)
+        return NOT_SCHEDULABLE;
+
+    /*
+     * The tasks above the new one keep their response times, the others
+     * are checked again. Theirs can only have grown, so each iteration
+     * resumes from the lower bound it reached before.
+     */
+    p = insertAt(set, position(set, task), task);
+    least = set->scratch + set->n;
+    for (i = 0; i < p; i++)
+        addAbove(set, i, set->task[i].least, &above);
+    for (i = p; i < set->n; i++) {
+        least[i] = set->task[i].least;
+        if ((set->scratch[i] = responseTime(set, i, &above, &least[i])) < 0) {
+            removeAt(set, p);
+            return NOT_SCHEDULABLE;
+        }
+    }
+    for (i = p; i < set->n; i++) {
+        set->task[i].response = set->scratch[i];
+        set->task[i].least = least[i];
+    }
+    return SCHEDULABLE;
+}
+
+
+// ---- EDF ----
+
+// demand of the jobs released at 0 (jitter taken off the deadline) and due by t
+static long demand(const TaskSet *set, long t) {
+    const PeriodicTask *task;
+    long h = 0;
+    int i;
+
+    for (i = 0; i < set->n; i++) {
+        task = &set->task[i];
+        if (window(task) <= t)
+            h += ((t - window(task)) / task->period + 1) * task->cost;
+    }
+    return h;
+}
+
+// latest absolute deadline before t, 0 when there is none
+static long deadlineBefore(const TaskSet *set, long t) {
+    const PeriodicTask *task;
+    long d, latest = 0;
+    int i;
+
+    for (i = 0; i < set->n; i++) {
+        task = &set->task[i];
+        if (window(task) < t) {
+            d = (t - window(task) - 1) / task->period * task->period + window(task);
+            if (d > latest)
+                latest = d;
+        }
+    }
+    return latest;
+}
+
+// the synchronous busy period: least w = sum ceil(w / T) C
+static long busyPeriod(const TaskSet *set) {
+    long w = 0, next = 0;
+    int i;
+
+    for (i = 0; i < set->n; i++)
+        next += set->task[i].cost;
+    while (next != w) {
+        w = next;
+        for (next = 0, i = 0; i < set->n; i++)
+            next += (w + set->task[i].period - 1) / set->task[i].period * set->task[i].cost;
+    }
+    return w;
+}
+
+int processorDemandTest(const TaskSet *set) {
+    double slack = 0;
+    long bound, first = 0, t, h;
+    int i;
+
+    if (set->utilisation > 1 + EPSILON)
+        return NOT_SCHEDULABLE;
+    if (set->constrained == 0 || set->density <= 1 + EPSILON)
+        return SCHEDULABLE;
+
+    // demand can only exceed t before max(D, sum (T - D) U / (1 - U)), or the busy period when U = 1
+    for (i = 0; i < set->n; i++) {
+        if (first == 0 || window(&set->task[i]) < first)
+            first = window(&set->task[i]);
+        slack += (double) (set->task[i].period - window(&set->task[i])) * set->task[i].cost / set->task[i].period;
+    }
+    if (set->utilisation < 1 - EPSILON) {
+        bound = (long) ceil(slack / (1 - set->utilisation));
+        for (i = 0; i < set->n; i++)
+            if (window(&set->task[i]) > bound)
+                bound = window(&set->task[i]);
+        bound++;
+    }
+    else
+        bound = busyPeriod(set) + 1;
+
+    // QPA: from the last deadline down, jumping to h(t) while it is below t
+    t = deadlineBefore(set, bound);
+    for (;;) {
+        h = demand(set, t);
+        if (h > t)
+            return NOT_SCHEDULABLE;
+        if (h <= first)
+            return SCHEDULABLE;
+        t = h < t ? h : deadlineBefore(set, t);
+    }
+}
+
+int admitEDF(TaskSet *set, const PeriodicTask *task) {
+    int p;
+
+    if (!valid(task) || set->utilisation + (double) task->cost / task->period > 1 + EPSILON)
+        return NOT_SCHEDULABLE;
+    p = insertAt(set, position(set, task), task);
+    if (processorDemandTest(set) == SCHEDULABLE)
+        return SCHEDULABLE;
+    removeAt(set, p);
+    return NOT_SCHEDULABLE;
+}
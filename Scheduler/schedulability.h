@@ -0,0 +1,75 @@
+/**
+ * Schedulability analysis of periodic tasks on one CPU.
+ *
+ * A task releases a job of cost C every period T, possibly up to jitter
+ * J late, which must complete within its relative deadline D (D <= T).
+ *
+ * - Liu & Layland: rate monotonic meets every deadline if the utilisation
+ *   U = sum C/T is at most n (2^(1/n) - 1); sufficient, for D = T, J = 0.
+ * - hyperbolic bound (Bini et al.): the same if prod (C/T + 1) <= 2; a
+ *   tighter sufficient test.
+ * - response time analysis: exact for fixed priorities, here deadline
+ *   monotonic (optimal for D <= T): the worst case response time is the
+ *   least fixed point of R = C + sum over higher priorities of
+ *   ceil((R + J') / T') C', and must be at most D - J.
+ * - processor demand: exact for EDF, U <= 1 and the demand of the jobs
+ *   due by t at most t at every deadline t up to a bound L, checked with
+ *   QPA (Zhang & Burns), which visits few of the deadlines.
+ *
+ * The set keeps U, the hyperbolic product and the density up to date, so
+ * admitting one more task first tries O(1) tests. Response time analysis
+ * then only looks at the new task and those of lower priority, each with
+ * a linear upper bound of its response time, iterating to the exact value
+ * only for those the bound does not show in time, from the lower bound
+ * reached when the previous task was admitted.
+ */
+
+#ifndef SCHEDULABILITY_H
+#define SCHEDULABILITY_H
+
+typedef struct {
+    const char *name;
+    long cost;          // C
+    long period;        // T
+    long deadline;      // D, relative to the release, at most T
+    long jitter;        // J
+    long response;      // R: an upper bound of the worst case response time, set when proven in time
+    long least;         // a lower bound of R, where its exact iteration resumes
+} PeriodicTask;
+
+typedef struct {
+    PeriodicTask *task;     // deadline monotonic order: task 0 has the highest priority
+    int n;
+    int capacity;
+    long *scratch;          // response times, then their lower bounds, while a task is being admitted
+    double utilisation;     // sum of C/T
+    double hyperbolic;      // product of (C/T + 1)
+    double density;         // sum of C/(D - J)
+    int constrained;        // tasks with D < T or jitter
+} TaskSet;
+
+// results of the tests
+#define NOT_SCHEDULABLE 0
+#define SCHEDULABLE     1
+
+void taskSetInit(TaskSet *set);
+void taskSetFree(TaskSet *set);
+
+// add a task without any test; -1 when it is malformed (C, T > 0, J >= 0, C <= D - J, D <= T)
+int taskSetAdd(TaskSet *set, const PeriodicTask *task);
+
+// whole set tests
+int liuLaylandTest(const TaskSet *set);
+int hyperbolicTest(const TaskSet *set);
+int responseTimeTest(TaskSet *set);         // sets the response times
+
+// exact worst case response time of task i, -1 past D - J
+long exactResponseTime(const TaskSet *set, int i);
+int processorDemandTest(const TaskSet *set);
+
+// add the task if the set stays schedulable under deadline monotonic
+// fixed priorities (response times updated), or under EDF
+int admitFixedPriority(TaskSet *set, const PeriodicTask *task);
+int admitEDF(TaskSet *set, const PeriodicTask *task);
+
+#endif
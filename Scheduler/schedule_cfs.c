@@ -0,0 +1,121 @@
+/**
+ * Completely fair scheduling, after Linux's CFS.
+ *
+ * Every task has a weight from its priority, through Linux's nice to
+ * weight table: priority 5 is nice 0 (weight 1024), each priority level
+ * is two nice levels, so priority 10 weighs 9548 and priority 1 172. A
+ * task's virtual runtime grows by the CPU time it gets, scaled by 1024 /
+ * weight, and the task with the least virtual runtime runs next: ready
+ * tasks are in a red-black tree on it (ties by tid), whose leftmost task
+ * is cached. Its slice is its weight's share of the scheduling period,
+ * LATENCY, stretched so that no slice is under MIN_GRANULARITY.
+ *
+ * The queue's minimum virtual runtime only moves forward. A task that
+ * arrives, or comes back from I/O, is placed no further back than half a
+ * period before it, so sleeping earns little credit.
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "tree.h"
+#include "policy.h"
+#include "CPU.h"
+
+#define LATENCY         (2 * QUANTUM)
+#define MIN_GRANULARITY (QUANTUM / 5)
+#define NICE_0_WEIGHT   1024
+#define VRUNTIME_SHIFT  10      // fixed point: virtual time units per CPU time unit at nice 0
+
+// Linux's sched_prio_to_weight, nice -20 to 19
+static const int niceWeight[40] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+    9548, 7620, 6100, 4904, 3906, 3121, 2501, 1991, 1586, 1277,
+    1024, 820, 655, 526, 423, 335, 272, 215, 172, 137,
+    110, 87, 70, 56, 45, 36, 29, 23, 18, 15
+};
+
+typedef struct {
+    TaskTree tree;
+    long load;              // sum of the weights of the tasks in the tree
+    long minVruntime;
+} FairQueue;
+
+int cfsWeight(int priority) {
+    int p = priority < MIN_PRIORITY ? MIN_PRIORITY : priority > MAX_PRIORITY ? MAX_PRIORITY : priority;
+
+    return niceWeight[20 + 2 * (5 - p)];
+}
+
+static int weight(Task *task) {
+    return cfsWeight(task->priority);
+}
+
+static int lessVruntime(Task *a, Task *b) {
+    return a->vruntime < b->vruntime || (a->vruntime == b->vruntime && a->tid < b->tid);
+}
+
+static void *cfsInit(void) {
+    FairQueue *queue = calloc(1, sizeof(FairQueue));
+
+    if (queue != NULL)
+        queue->tree.before = lessVruntime;
+    return queue;
+}
+
+static void cfsEnqueue(void *rq, Task *task) {
+    FairQueue *queue = rq;
+    long floor = queue->minVruntime - ((long) LATENCY << VRUNTIME_SHIFT) / 2;
+
+    if (task->vruntime < floor)
+        task->vruntime = floor;
+    treeInsert(&queue->tree, task);
+    queue->load += weight(task);
+}
+
+static Task *take(FairQueue *queue, Task *task) {
+    if (task == NULL)
+        return NULL;
+    treeRemove(&queue->tree, task);
+    queue->load -= weight(task);
+    return task;
+}
+
+static Task *cfsPickNext(void *rq) {
+    FairQueue *queue = rq;
+    Task *task = take(queue, treeFirst(&queue->tree));
+
+    if (task != NULL && task->vruntime > queue->minVruntime)
+        queue->minVruntime = task->vruntime;
+    return task;
+}
+
+// the task furthest ahead, the one its owner would run last
+static Task *cfsSteal(void *rq) {
+    FairQueue *queue = rq;
+
+    return take(queue, treeLast(&queue->tree));
+}
+
+static int cfsSlice(void *rq, Task *task) {
+    FairQueue *queue = rq;
+    long period = LATENCY, running = queue->tree.size + 1, slice;
+
+    if (period < running * MIN_GRANULARITY)
+        period = running * MIN_GRANULARITY;
+    slice = period * weight(task) / (queue->load + weight(task));
+    return slice > 0 ? slice : 1;
+}
+
+static void cfsTick(void *rq, Task *task, int ran) {
+    task->vruntime += ((long) ran << VRUNTIME_SHIFT) * NICE_0_WEIGHT / weight(task);
+}
+
+static void cfsDestroy(void *rq) {
+    free(rq);
+}
+
+const Policy cfsPolicy = {
+    "cfs", "completely fair: least weighted CPU time first, on a red-black tree",
+    cfsInit, cfsEnqueue, cfsPickNext, cfsSlice, cfsTick, NULL, cfsDestroy, cfsSteal
+};
@@ -1,11 +1,42 @@
-#include "schedule_edf.h"
+/**
+ * Earliest Deadline First scheduling.
+ *
+ * Ready tasks are kept in a min-heap on their (absolute) deadline. The
+ * earliest one runs for a quantum and goes back into the heap if it is
+ * not done, so at every quantum boundary the earliest deadline runs next.
+ * Tasks without a deadline (0) only run when no task with one is ready.
+ * Deadline misses are detected by the virtual CPU, for every policy.
+ */
 
-// add a task to the list 
-void add(char *name, int priority, int burst, int deadline){
-   int x = 0;
+#include <stdlib.h>
+
+#include "task.h"
+#include "heap.h"
+#include "policy.h"
+#include "CPU.h"
+
+static void *edfInit(void) {
+    return calloc(1, sizeof(TaskHeap));
 }
 
-// invoke the scheduler
-void schedule(){
-   int x = 0;
+static void edfEnqueue(void *rq, Task *task) {
+    heapPush(rq, task);
 }
+
+static Task *edfPickNext(void *rq) {
+    return heapPop(rq);
+}
+
+static int quantum(void *rq, Task *task) {
+    return QUANTUM;
+}
+
+static void edfDestroy(void *rq) {
+    heapFree(rq);
+    free(rq);
+}
+
+const Policy edfPolicy = {
+    "edf", "earliest deadline first, preempting at quantum boundaries",
+    edfInit, edfEnqueue, edfPickNext, quantum, NULL, NULL, edfDestroy, NULL
+};
@@ -0,0 +1,53 @@
+/**
+ * First come first served and round-robin scheduling.
+ *
+ * Both serve a single FIFO queue. FCFS lets a task run to completion,
+ * round-robin takes it back after a quantum and puts it at the tail.
+ * Another CPU steals from the tail, the end its owner doesn't use.
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "queue.h"
+#include "policy.h"
+#include "CPU.h"
+
+static void *fifoInit(void) {
+    return calloc(1, sizeof(TaskQueue));
+}
+
+static void fifoEnqueue(void *rq, Task *task) {
+    queuePush(rq, task);
+}
+
+static Task *fifoPickNext(void *rq) {
+    return queuePop(rq);
+}
+
+static Task *fifoSteal(void *rq) {
+    return queuePopTail(rq);
+}
+
+static void fifoDestroy(void *rq) {
+    queueFree(rq);
+    free(rq);
+}
+
+static int wholeBurst(void *rq, Task *task) {
+    return task->remaining;
+}
+
+static int quantum(void *rq, Task *task) {
+    return QUANTUM;
+}
+
+const Policy fcfsPolicy = {
+    "fcfs", "first come first served",
+    fifoInit, fifoEnqueue, fifoPickNext, wholeBurst, NULL, NULL, fifoDestroy, fifoSteal
+};
+
+const Policy rrPolicy = {
+    "rr", "round-robin, QUANTUM long slices",
+    fifoInit, fifoEnqueue, fifoPickNext, quantum, NULL, NULL, fifoDestroy, fifoSteal
+};
@@ -0,0 +1,125 @@
+/**
+ * Multilevel feedback queue scheduling.
+ *
+ * New tasks start at the top level. The first task of the highest level
+ * that is not empty runs for what is left of that level's quantum; once
+ * a task has used the whole quantum at a level, over however many slices
+ * (giving up the CPU for I/O does not reset it), it moves one level down,
+ * where quanta are longer. So interactive tasks stay on top and CPU bound
+ * ones sink. After every mlfqBoost units of CPU time served from a queue,
+ * all the tasks waiting in it go back to the top level, so that the ones
+ * at the bottom do not starve. Priorities are not used: MLFQ learns them.
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "queue.h"
+#include "policy.h"
+#include "CPU.h"
+
+int mlfqLevels = 3;
+int mlfqQuantum[MLFQ_MAX_LEVELS] = { QUANTUM, 2 * QUANTUM, 4 * QUANTUM, 8 * QUANTUM,
+                                     16 * QUANTUM, 32 * QUANTUM, 64 * QUANTUM, 128 * QUANTUM };
+int mlfqBoost = 100 * QUANTUM;
+
+typedef struct {
+    TaskQueue level[MLFQ_MAX_LEVELS];
+    unsigned int ready;     // bit l is set while level l is not empty
+    long served;            // CPU time since the last boost
+} Levels;
+
+static void *mlfqInit(void) {
+    return calloc(1, sizeof(Levels));
+}
+
+static void mlfqEnqueue(void *rq, Task *task) {
+    Levels *levels = rq;
+
+    queuePush(&levels->level[task->level], task);
+    levels->ready |= 1u << task->level;
+}
+
+// every waiting task to the top level, keeping the order of their levels
+static void boost(Levels *levels) {
+    int l;
+
+    for (l = 1; l < mlfqLevels; l++)
+        queueAppend(&levels->level[0], &levels->level[l]);
+    levels->ready = levels->level[0].size > 0;
+    levels->served = 0;
+}
+
+static Task *mlfqPickNext(void *rq) {
+    Levels *levels = rq;
+    Task *task;
+    int l;
+
+    if (levels->ready == 0)
+        return NULL;
+    l = __builtin_ctz(levels->ready);
+    task = queuePop(&levels->level[l]);
+    if (levels->level[l].size == 0)
+        levels->ready &= ~(1u << l);
+
+    // boosted while it waited
+    if (task->level != l) {
+        task->level = l;
+        task->used = 0;
+    }
+    return task;
+}
+
+// the newest task of the lowest level, the one its owner would run last
+static Task *mlfqSteal(void *rq) {
+    Levels *levels = rq;
+    Task *task;
+    int l;
+
+    if (levels->ready == 0)
+        return NULL;
+    l = 31 - __builtin_clz(levels->ready);
+    task = queuePopTail(&levels->level[l]);
+    if (levels->level[l].size == 0)
+        levels->ready &= ~(1u << l);
+    if (task->level != l) {
+        task->level = l;
+        task->used = 0;
+    }
+    return task;
+}
+
+static int mlfqSlice(void *rq, Task *task) {
+    return mlfqQuantum[task->level] - task->used;
+}
+
+static void account(Levels *levels, Task *task, int ran) {
+    task->used += ran;
+    if (task->used >= mlfqQuantum[task->level]) {
+        if (task->level < mlfqLevels - 1)
+            task->level++;
+        task->used = 0;
+    }
+    levels->served += ran;
+    if (levels->served >= mlfqBoost) {
+        boost(levels);
+        task->level = task->used = 0;
+    }
+}
+
+static void mlfqTick(void *rq, Task *task, int ran) {
+    account(rq, task, ran);
+}
+
+static void mlfqComplete(void *rq, Task *task) {
+    account(rq, task, task->slice);
+}
+
+static void mlfqDestroy(void *rq) {
+    free(rq);
+}
+
+const Policy mlfqPolicy = {
+    "mlfq", "multilevel feedback queue, demotion on a used up quantum, periodic boost",
+    mlfqInit, mlfqEnqueue, mlfqPickNext, mlfqSlice, mlfqTick, mlfqComplete, mlfqDestroy, mlfqSteal
+};
@@ -1,11 +1,102 @@
-#include "schedule_rr_p.h"
+/**
+ * Priority and priority round-robin scheduling.
+ *
+ * The highest priority (largest number) ready task runs. Each priority
+ * level has its own FIFO run queue, and a bitmap records which levels are
+ * not empty, so the next task is found with one find-last-set instead of
+ * a scan. Priority scheduling runs the task to completion; priority
+ * round-robin runs it for a quantum, tasks of the same priority taking
+ * turns. Another CPU steals the newest task of the lowest priority level,
+ * the one its owner would run last.
+ */
 
-// add a task to the list 
-void add(char *name, int priority, int burst){
-   int x = 0;
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "task.h"
+#include "queue.h"
+#include "policy.h"
+#include "CPU.h"
+
+typedef struct {
+    TaskQueue level[MAX_PRIORITY + 1];
+    unsigned int ready;     // bit p is set while level p is not empty
+    int clamped;            // an out of range priority was reported
+} PriorityQueues;
+
+static void *levelsInit(void) {
+    return calloc(1, sizeof(PriorityQueues));
+}
+
+// append a task at the tail of the queue of its priority; an out of range
+// priority is clamped here only, the task is shared with the other policies
+static void levelsEnqueue(void *rq, Task *task) {
+    PriorityQueues *queues = rq;
+    int p = task->priority;
+
+    if (p < MIN_PRIORITY || p > MAX_PRIORITY) {
+        if (!queues->clamped)
+            fprintf(stderr, "task %s: priority %d out of [%d, %d], clamped\n",
+                    task->name, p, MIN_PRIORITY, MAX_PRIORITY);
+        queues->clamped = 1;
+        p = p < MIN_PRIORITY ? MIN_PRIORITY : MAX_PRIORITY;
+    }
+    queuePush(&queues->level[p], task);
+    queues->ready |= 1u << p;
 }
 
-// invoke the scheduler
-void schedule(){
-   int x = 0;
+// remove the task at the head of the highest priority level
+static Task *levelsPickNext(void *rq) {
+    PriorityQueues *queues = rq;
+    Task *task;
+    int p;
+
+    if (queues->ready == 0)
+        return NULL;
+    p = 31 - __builtin_clz(queues->ready);
+    task = queuePop(&queues->level[p]);
+    if (queues->level[p].size == 0)
+        queues->ready &= ~(1u << p);
+    return task;
+}
+
+static Task *levelsSteal(void *rq) {
+    PriorityQueues *queues = rq;
+    Task *task;
+    int p;
+
+    if (queues->ready == 0)
+        return NULL;
+    p = __builtin_ctz(queues->ready);
+    task = queuePopTail(&queues->level[p]);
+    if (queues->level[p].size == 0)
+        queues->ready &= ~(1u << p);
+    return task;
 }
+
+static void levelsDestroy(void *rq) {
+    PriorityQueues *queues = rq;
+    int p;
+
+    for (p = 0; p <= MAX_PRIORITY; p++)
+        queueFree(&queues->level[p]);
+    free(queues);
+}
+
+static int wholeBurst(void *rq, Task *task) {
+    return task->remaining;
+}
+
+static int quantum(void *rq, Task *task) {
+    return QUANTUM;
+}
+
+const Policy priorityPolicy = {
+    "priority", "highest priority first",
+    levelsInit, levelsEnqueue, levelsPickNext, wholeBurst, NULL, NULL, levelsDestroy, levelsSteal
+};
+
+const Policy rrPriorityPolicy = {
+    "rr_p", "highest priority first, round-robin within a priority",
+    levelsInit, levelsEnqueue, levelsPickNext, quantum, NULL, NULL, levelsDestroy, levelsSteal
+};
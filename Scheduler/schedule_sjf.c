@@ -0,0 +1,46 @@
+/**
+ * Shortest job first scheduling.
+ *
+ * The ready task with the least CPU time left runs to completion; ready
+ * tasks are in a heap on their remaining time (ties by tid).
+ */
+
+#include <stdlib.h>
+
+#include "task.h"
+#include "heap.h"
+#include "policy.h"
+
+static int shorter(Task *a, Task *b) {
+    return a->remaining < b->remaining || (a->remaining == b->remaining && a->tid < b->tid);
+}
+
+static void *sjfInit(void) {
+    TaskHeap *heap = calloc(1, sizeof(TaskHeap));
+
+    if (heap != NULL)
+        heap->before = shorter;
+    return heap;
+}
+
+static void sjfEnqueue(void *rq, Task *task) {
+    heapPush(rq, task);
+}
+
+static Task *sjfPickNext(void *rq) {
+    return heapPop(rq);
+}
+
+static int wholeBurst(void *rq, Task *task) {
+    return task->remaining;
+}
+
+static void sjfDestroy(void *rq) {
+    heapFree(rq);
+    free(rq);
+}
+
+const Policy sjfPolicy = {
+    "sjf", "shortest job first",
+    sjfInit, sjfEnqueue, sjfPickNext, wholeBurst, NULL, NULL, sjfDestroy, NULL
+};
@@ -0,0 +1,67 @@
+/**
+ * Slab allocator.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "slab.h"
+
+// the chunk link, padded so that the objects after it stay aligned
+typedef union {
+    void *next;
+    long double align;
+} ChunkHeader;
+
+void slabInit(Slab *slab, size_t size, int perChunk) {
+    if (size < sizeof(void *))
+        size = sizeof(void *);
+    slab->size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+    slab->perChunk = perChunk > 0 ? perChunk : 1;
+    slab->free = NULL;
+    slab->chunks = NULL;
+    slab->used = 0;
+}
+
+void *slabAlloc(Slab *slab) {
+    ChunkHeader *chunk;
+    char *object;
+    int i;
+
+    if (slab->free == NULL) {
+        // a new chunk, all of its objects on the free list, first one first
+        if ((chunk = malloc(sizeof(ChunkHeader) + slab->perChunk * slab->size)) == NULL) {
+            fprintf(stderr, "out of memory for a slab of %d objects\n", slab->perChunk);
+            exit(1);
+        }
+        chunk->next = slab->chunks;
+        slab->chunks = chunk;
+        object = (char *) (chunk + 1);
+        for (i = 0; i < slab->perChunk - 1; i++)
+            *(void **) (object + i * slab->size) = object + (i + 1) * slab->size;
+        *(void **) (object + i * slab->size) = NULL;
+        slab->free = object;
+    }
+
+    object = slab->free;
+    slab->free = *(void **) object;
+    slab->used++;
+    return object;
+}
+
+void slabFree(Slab *slab, void *object) {
+    *(void **) object = slab->free;
+    slab->free = object;
+    slab->used--;
+}
+
+void slabDestroy(Slab *slab) {
+    ChunkHeader *chunk;
+
+    while ((chunk = slab->chunks) != NULL) {
+        slab->chunks = chunk->next;
+        free(chunk);
+    }
+    slab->free = NULL;
+    slab->used = 0;
+}
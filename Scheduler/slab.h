@@ -0,0 +1,28 @@
+/**
+ * Slab allocator for objects of one size.
+ *
+ * Objects are carved from chunks of perChunk of them, and a freed object
+ * goes on a free list threaded through its own first word, so allocating
+ * and freeing is a few instructions and no call to malloc, except once
+ * per chunk. The chunks are only given back by slabDestroy.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+
+typedef struct {
+    size_t size;        // of an object, rounded up to a multiple of a pointer
+    int perChunk;
+    void *free;         // free objects, each pointing to the next
+    void *chunks;       // chunks, each pointing to the next
+    long used;          // objects handed out and not freed
+} Slab;
+
+void slabInit(Slab *slab, size_t size, int perChunk);
+void *slabAlloc(Slab *slab);
+void slabFree(Slab *slab, void *object);
+void slabDestroy(Slab *slab);
+
+#endif
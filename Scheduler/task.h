@@ -8,10 +8,34 @@
 // representation of a task
 typedef struct task {
     char *name;
-    int tid;
+    int tid;            // index in the array of all the tasks
     int priority;
-    int burst;
-    int deadline;
+    int burst;          // total CPU time
+    int deadline;       // absolute, 0 for none
+    int arrival;        // time it enters the system
+    int ioInterval;     // CPU time between two I/O bursts, 0 for none
+    int ioTime;         // length of an I/O burst
+    int heapIndex;      // slot in a heap of tasks, -1 when not in one
+    struct task *next;  // links in a run queue
+    struct task *prev;
+    struct task *left;  // links in a tree of tasks
+    struct task *right;
+    struct task *parent;
+    int red;
+
+    // kept by the virtual CPU while the task is simulated
+    int remaining;      // CPU time still needed
+    int sinceIO;        // CPU time since the last I/O burst
+    int slice;          // length of the slice it was last given
+    int cpu;            // CPU it last ran on, -1 before
+    long start;         // first time it ran, -1 before
+    long finish;        // completion time, -1 before
+    long blocked;       // time spent in I/O
+
+    // kept by the policies, reset by the virtual CPU
+    int level;          // MLFQ level, 0 the top one
+    int used;           // MLFQ: CPU time used at that level
+    long vruntime;      // CFS: CPU time weighted by the inverse of the priority's weight
 } Task;
 
 #endif
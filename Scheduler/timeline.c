@@ -0,0 +1,245 @@
+/**
+ * Timeline of a simulation from its event log (see eventlog.h), written
+ * by schedule -l.
+ *
+ * usage: timeline [-f chrome|gantt] [-o file] log-file
+ *
+ * chrome (the default) is the trace event JSON read by chrome://tracing
+ * and Perfetto: a row per CPU, a bar per slice, marks where tasks
+ * complete, miss their deadline or start an I/O burst; a time unit is
+ * shown as a microsecond. gantt is CSV, a line per bar
+ *
+ *  cpu, task, start, end, how
+ *
+ * the slices a task runs back to back on a CPU merged into one bar, how
+ * the bar ended: preempt, io, complete or miss (completed late).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "eventlog.h"
+
+typedef struct {
+    int cpus;
+    int n;
+    char policy[LOG_POLICY_SIZE + 1];
+    const char **name;      // by tid
+    const LogRecord *record;
+    long records;
+} Log;
+
+// a bar of the Gantt chart still open on a CPU
+typedef struct {
+    int task;               // -1 for none
+    long start;
+    long end;
+    int how;                // type of the record that ended it
+} Bar;
+
+static const char *howName[] = { "", "preempt", "io", "complete", "miss" };
+
+// check and index the mapped log; 0, or -1 after printing why
+static int readLog(const char *path, const char *data, size_t size, Log *log) {
+    const char *names, *p;
+    int32_t header[2];
+    uint64_t namesSize;
+    int i;
+
+    if (size < LOG_HEADER_SIZE || memcmp(data, LOG_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: not an event log\n", path);
+        return -1;
+    }
+    memcpy(header, data + 4, sizeof(header));
+    memcpy(log->policy, data + 4 + sizeof(header), LOG_POLICY_SIZE);
+    log->policy[LOG_POLICY_SIZE] = '\0';
+    memcpy(&namesSize, data + 4 + sizeof(header) + LOG_POLICY_SIZE, sizeof(namesSize));
+    log->n = header[0];
+    log->cpus = header[1];
+    if (log->n < 0 || log->cpus < 1 || namesSize > size - LOG_HEADER_SIZE ||
+        (LOG_HEADER_SIZE + namesSize) % 8 != 0 || (size - LOG_HEADER_SIZE - namesSize) % sizeof(LogRecord) != 0) {
+        fprintf(stderr, "%s: truncated or corrupt event log\n", path);
+        return -1;
+    }
+
+    if ((log->name = malloc((log->n + 1) * sizeof(char *))) == NULL) {
+        fprintf(stderr, "out of memory for %d tasks\n", log->n);
+        return -1;
+    }
+    names = p = data + LOG_HEADER_SIZE;
+    for (i = 0; i < log->n; i++) {
+        if (p >= names + namesSize || memchr(p, '\0', names + namesSize - p) == NULL) {
+            fprintf(stderr, "%s: %d task names, expected %d\n", path, i, log->n);
+            free(log->name);
+            return -1;
+        }
+        log->name[i] = p;
+        p += strlen(p) + 1;
+    }
+
+    log->records = (size - LOG_HEADER_SIZE - namesSize) / sizeof(LogRecord);
+    log->record = (const LogRecord *) (names + namesSize);
+    return 0;
+}
+
+static int validRecord(const Log *log, const LogRecord *r) {
+    return r->type >= LOG_SWITCH && r->type <= LOG_MISS && r->cpu >= 0 && r->cpu < log->cpus &&
+           r->task >= 0 && r->task < log->n;
+}
+
+// s as a JSON string
+static void jsonString(FILE *out, const char *s) {
+    putc('"', out);
+    for (; *s != '\0'; s++)
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if ((unsigned char) *s < 0x20)
+            fprintf(out, "\\u%04x", *s);
+        else
+            putc(*s, out);
+    putc('"', out);
+}
+
+static void writeChrome(FILE *out, const Log *log) {
+    const LogRecord *r;
+    long i;
+    int c;
+
+    fprintf(out, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":");
+    jsonString(out, log->policy);
+    fprintf(out, "}}");
+    for (c = 0; c < log->cpus; c++)
+        fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"CPU %d\"}}", c, c);
+
+    for (i = 0; i < log->records; i++) {
+        r = &log->record[i];
+        if (!validRecord(log, r) || r->type == LOG_PREEMPT)
+            continue;
+        fprintf(out, ",\n{\"name\":");
+        jsonString(out, log->name[r->task]);
+        switch (r->type) {
+        case LOG_SWITCH:
+            fprintf(out, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%d", (long long) r->time, r->value);
+            break;
+        case LOG_BLOCK:
+            fprintf(out, ",\"cat\":\"io\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"args\":{\"io\":%d}",
+                    (long long) r->time, r->value);
+            break;
+        case LOG_COMPLETE:
+            fprintf(out, ",\"cat\":\"complete\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"args\":{\"turnaround\":%d}",
+                    (long long) r->time, r->value);
+            break;
+        case LOG_MISS:
+            fprintf(out, ",\"cat\":\"miss\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%lld,\"args\":{\"late\":%d}",
+                    (long long) r->time, r->value);
+            break;
+        }
+        fprintf(out, ",\"pid\":0,\"tid\":%d}", r->cpu);
+    }
+    fprintf(out, "\n]}\n");
+}
+
+static void writeBar(FILE *out, const Log *log, int c, const Bar *bar) {
+    fprintf(out, "%d,%s,%ld,%ld,%s\n", c, log->name[bar->task], bar->start, bar->end, howName[bar->how]);
+}
+
+static int writeGantt(FILE *out, const Log *log) {
+    const LogRecord *r;
+    Bar *bar = malloc(log->cpus * sizeof(Bar));
+    long i;
+    int c;
+
+    if (bar == NULL) {
+        fprintf(stderr, "out of memory for %d CPUs\n", log->cpus);
+        return -1;
+    }
+    for (c = 0; c < log->cpus; c++)
+        bar[c].task = -1;
+
+    fprintf(out, "cpu,task,start,end,how\n");
+    for (i = 0; i < log->records; i++) {
+        r = &log->record[i];
+        if (!validRecord(log, r))
+            continue;
+        c = r->cpu;
+        if (r->type != LOG_SWITCH) {
+            // a miss comes right after the completion
+            if (bar[c].task == r->task)
+                bar[c].how = r->type;
+            continue;
+        }
+        if (bar[c].task == r->task && bar[c].how == LOG_PREEMPT && bar[c].end == r->time) {
+            bar[c].end += r->value;
+            continue;
+        }
+        if (bar[c].task >= 0)
+            writeBar(out, log, c, &bar[c]);
+        bar[c].task = r->task;
+        bar[c].start = r->time;
+        bar[c].end = r->time + r->value;
+        bar[c].how = LOG_PREEMPT;
+    }
+    for (c = 0; c < log->cpus; c++)
+        if (bar[c].task >= 0)
+            writeBar(out, log, c, &bar[c]);
+    free(bar);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *format = "chrome", *outName = NULL;
+    struct stat st;
+    void *data;
+    FILE *out = stdout;
+    Log log;
+    int fd, opt, error = 0;
+
+    while ((opt = getopt(argc, argv, "f:o:")) != -1)
+        switch (opt) {
+        case 'f': format = optarg; break;
+        case 'o': outName = optarg; break;
+        default: error = 1; break;
+        }
+    if (error || optind + 1 != argc || (strcmp(format, "chrome") != 0 && strcmp(format, "gantt") != 0)) {
+        fprintf(stderr, "usage: %s [-f chrome|gantt] [-o file] log-file\n", argv[0]);
+        return 1;
+    }
+
+    if ((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    data = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (readLog(argv[optind], data, st.st_size, &log) < 0)
+        return 1;
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    if (outName != NULL && (out = fopen(outName, "w")) == NULL) {
+        perror(outName);
+        return 1;
+    }
+    if (strcmp(format, "chrome") == 0)
+        writeChrome(out, &log);
+    else
+        error = writeGantt(out, &log) < 0;
+    if (fclose(out) != 0) {
+        perror(outName != NULL ? outName : "stdout");
+        error = 1;
+    }
+
+    free(log.name);
+    munmap(data, st.st_size);
+    return error;
+}
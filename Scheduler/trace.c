@@ -0,0 +1,256 @@
+/**
+ * Trace loader.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "task.h"
+#include "trace.h"
+
+#define TRACE_FIELDS 7
+
+// the binary format is little endian whatever the host
+static uint32_t le32(const unsigned char *b) {
+    return b[0] | (uint32_t) b[1] << 8 | (uint32_t) b[2] << 16 | (uint32_t) b[3] << 24;
+}
+
+static uint64_t le64(const unsigned char *b) {
+    return le32(b) | (uint64_t) le32(b + 4) << 32;
+}
+
+static void putLe32(unsigned char *b, uint32_t v) {
+    b[0] = v;
+    b[1] = v >> 8;
+    b[2] = v >> 16;
+    b[3] = v >> 24;
+}
+
+static void putLe64(unsigned char *b, uint64_t v) {
+    putLe32(b, v);
+    putLe32(b + 4, v >> 32);
+}
+
+// skip blanks, then an optionally signed decimal number and blanks up to the
+// next comma or the end of the line; -1 when the field is empty, holds
+// something else or doesn't fit an int
+static int parseInt(const char **p, const char *end, int *value) {
+    const char *s = *p;
+    long number = 0;
+    int negative = 0, digits = 0;
+
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    if (s < end && *s == '-') {
+        negative = 1;
+        s++;
+    }
+    for (; s < end && *s >= '0' && *s <= '9'; digits++)
+        if ((number = number * 10 + (*s++ - '0')) > INT_MAX)
+            return -1;
+    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+        s++;
+    *p = s;
+    if (digits == 0 || (s < end && *s != ',' && *s != '\n'))
+        return -1;
+    *value = negative ? -number : number;
+    return 0;
+}
+
+static int loadText(const char *path, const char *text, size_t size, Trace *trace) {
+    const char *end = text + size, *p, *name;
+    size_t lines = 1, length;
+    Task *task;
+    int i, line = 0, field[TRACE_FIELDS - 1];
+
+    // one task per line at most, the names take less than the file
+    for (p = text; (p = memchr(p, '\n', end - p)) != NULL; p++)
+        lines++;
+    trace->tasks = malloc(lines * sizeof(Task));
+    trace->names = malloc(size + 1);
+    if (trace->tasks == NULL || trace->names == NULL) {
+        fprintf(stderr, "%s: out of memory for %zu tasks\n", path, lines);
+        return -1;
+    }
+
+    for (p = text; p < end; p++) {
+        line++;
+        // name: up to the first comma, blanks trimmed; blank lines and # comments are skipped
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p == end)
+            break;
+        if (*p == '\n' || *p == '\r' || *p == '#') {
+            while (p < end && *p != '\n')
+                p++;
+            continue;
+        }
+        for (name = p; p < end && *p != ',' && *p != '\n'; p++)
+            ;
+        for (length = p - name; length > 0 && (name[length - 1] == ' ' || name[length - 1] == '\t' ||
+                                                name[length - 1] == '\r'); length--)
+            ;
+
+        for (i = 0; i < TRACE_FIELDS - 1; i++) {
+            field[i] = 0;
+            if (p < end && *p == ',') {
+                p++;
+                if (parseInt(&p, end, &field[i]) != 0) {
+                    fprintf(stderr, "%s:%d: expected name, priority, burst[, deadline[, arrival"
+                            "[, I/O interval[, I/O burst]]]]\n", path, line);
+                    return -1;
+                }
+            }
+        }
+        while (p < end && *p != '\n')
+            p++;
+
+        task = &trace->tasks[trace->n];
+        task->name = trace->names + trace->namesSize;
+        memcpy(task->name, name, length);
+        task->name[length] = '\0';
+        trace->namesSize += length + 1;
+        task->tid = trace->n++;
+        task->priority = field[0];
+        task->burst = field[1];
+        task->deadline = field[2];
+        task->arrival = field[3];
+        task->ioInterval = field[4];
+        task->ioTime = field[5];
+    }
+    return 0;
+}
+
+static int loadBinary(const char *path, const char *data, size_t size, Trace *trace) {
+    const unsigned char *record;
+    uint32_t count, name;
+    uint64_t namesSize;
+    int i;
+
+    if (size < 16) {
+        fprintf(stderr, "%s: not a valid binary trace\n", path);
+        return -1;
+    }
+    count = le32((const unsigned char *) data + 4);
+    namesSize = le64((const unsigned char *) data + 8);
+    if ((size - 16) / (TRACE_FIELDS * sizeof(int32_t)) < count ||
+        size - 16 - (size_t) count * TRACE_FIELDS * sizeof(int32_t) != namesSize ||
+        (namesSize > 0 && data[size - 1] != '\0')) {
+        fprintf(stderr, "%s: not a valid binary trace\n", path);
+        return -1;
+    }
+
+    trace->n = count;
+    trace->names = (char *) data + 16 + (size_t) count * TRACE_FIELDS * sizeof(int32_t);
+    trace->namesSize = namesSize;
+    if ((trace->tasks = malloc((count ? count : 1) * sizeof(Task))) == NULL) {
+        fprintf(stderr, "%s: out of memory for %u tasks\n", path, count);
+        return -1;
+    }
+
+    record = (const unsigned char *) data + 16;
+    for (i = 0; i < trace->n; i++, record += TRACE_FIELDS * sizeof(int32_t)) {
+        if ((name = le32(record)) >= namesSize) {
+            fprintf(stderr, "%s: task %d: name outside the names\n", path, i);
+            return -1;
+        }
+        trace->tasks[i].name = trace->names + name;
+        trace->tasks[i].tid = i;
+        trace->tasks[i].priority = (int32_t) le32(record + 4);
+        trace->tasks[i].burst = (int32_t) le32(record + 8);
+        trace->tasks[i].deadline = (int32_t) le32(record + 12);
+        trace->tasks[i].arrival = (int32_t) le32(record + 16);
+        trace->tasks[i].ioInterval = (int32_t) le32(record + 20);
+        trace->tasks[i].ioTime = (int32_t) le32(record + 24);
+    }
+    return 0;
+}
+
+int loadTrace(const char *path, Trace *trace) {
+    struct stat st;
+    char *data;
+    int fd, result;
+
+    memset(trace, 0, sizeof(Trace));
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror(path);
+        return -1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    if (st.st_size >= 4 && memcmp(data, TRACE_MAGIC, 4) == 0) {
+        trace->mapping = data;
+        trace->mappingSize = st.st_size;
+        result = loadBinary(path, data, st.st_size, trace);
+    }
+    else {
+        result = loadText(path, data, st.st_size, trace);
+        munmap(data, st.st_size);
+    }
+
+    if (result < 0)
+        freeTrace(trace);
+    return result;
+}
+
+int saveTrace(const char *path, Trace *trace) {
+    FILE *out;
+    unsigned char header[16], record[TRACE_FIELDS * sizeof(int32_t)];
+    uint64_t namesSize = trace->namesSize;
+    int i, ok;
+
+    if ((out = fopen(path, "wb")) == NULL) {
+        perror(path);
+        return -1;
+    }
+    memcpy(header, TRACE_MAGIC, 4);
+    putLe32(header + 4, trace->n);
+    putLe64(header + 8, namesSize);
+    ok = fwrite(header, sizeof(header), 1, out) == 1;
+    for (i = 0; ok && i < trace->n; i++) {
+        putLe32(record, trace->tasks[i].name - trace->names);
+        putLe32(record + 4, trace->tasks[i].priority);
+        putLe32(record + 8, trace->tasks[i].burst);
+        putLe32(record + 12, trace->tasks[i].deadline);
+        putLe32(record + 16, trace->tasks[i].arrival);
+        putLe32(record + 20, trace->tasks[i].ioInterval);
+        putLe32(record + 24, trace->tasks[i].ioTime);
+        ok = fwrite(record, sizeof(record), 1, out) == 1;
+    }
+    if (ok && namesSize > 0)
+        ok = fwrite(trace->names, namesSize, 1, out) == 1;
+    if (fclose(out) != 0 || !ok) {
+        fprintf(stderr, "%s: write failed\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+void freeTrace(Trace *trace) {
+    free(trace->tasks);
+    if (trace->mapping != NULL)
+        munmap(trace->mapping, trace->mappingSize);
+    else
+        free(trace->names);
+    memset(trace, 0, sizeof(Trace));
+}
@@ -0,0 +1,47 @@
+/**
+ * Loading a schedule (trace of tasks) in one go.
+ *
+ * Text traces are the lines read by driver.c:
+ *
+ *  [name], [priority], [CPU burst][, deadline[, arrival[, I/O interval[, I/O burst]]]]
+ *
+ * The file is mapped and parsed in place; the tasks go in one array and
+ * their names, one after the other, in one arena.
+ * Binary traces hold the same fields as little endian integers:
+ *
+ *  "TRC1" count namesSize   header, count on 32 bits, namesSize (the size
+ *                           of the arena) on 64 bits
+ *  count x 7 integers       32 bits each: name offset, priority, burst,
+ *                           deadline, arrival, I/O interval, I/O burst
+ *  namesSize bytes          the names, each ended by a NUL
+ *
+ * and are read from the mapping: no parsing, the names are not even copied.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+#include "task.h"
+
+#define TRACE_MAGIC "TRC1"
+
+typedef struct {
+    Task *tasks;        // n tasks, tid is the index
+    int n;
+    char *names;        // arena of the names
+    size_t namesSize;
+    void *mapping;      // the mapped file, kept for binary traces
+    size_t mappingSize;
+} Trace;
+
+// load a text or binary trace; 0, or -1 after printing why
+int loadTrace(const char *path, Trace *trace);
+
+// save a trace in the binary format; 0, or -1 after printing why
+int saveTrace(const char *path, Trace *trace);
+
+void freeTrace(Trace *trace);
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * Red-black tree of tasks (Cormen et al., with NULL leaves).
+ */
+
+#include <stdlib.h>
+
+#include "tree.h"
+#include "task.h"
+
+static int isRed(Task *task) {
+    return task != NULL && task->red;
+}
+
+// put v where u hangs from its parent
+static void replace(TaskTree *tree, Task *u, Task *v) {
+    if (u->parent == NULL)
+        tree->root = v;
+    else if (u == u->parent->left)
+        u->parent->left = v;
+    else
+        u->parent->right = v;
+    if (v != NULL)
+        v->parent = u->parent;
+}
+
+static void rotateLeft(TaskTree *tree, Task *x) {
+    Task *y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL)
+        y->left->parent = x;
+    replace(tree, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+static void rotateRight(TaskTree *tree, Task *x) {
+    Task *y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL)
+        y->right->parent = x;
+    replace(tree, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+static Task *leftmost(Task *task) {
+    while (task->left != NULL)
+        task = task->left;
+    return task;
+}
+
+static Task *successor(Task *task) {
+    if (task->right != NULL)
+        return leftmost(task->right);
+    while (task->parent != NULL && task == task->parent->right)
+        task = task->parent;
+    return task->parent;
+}
+
+void treeInsert(TaskTree *tree, Task *task) {
+    Task *parent = NULL, *x = tree->root, *uncle;
+
+    while (x != NULL) {
+        parent = x;
+        x = tree->before(task, x) ? x->left : x->right;
+    }
+    task->parent = parent;
+    task->left = task->right = NULL;
+    task->red = 1;
+    if (parent == NULL)
+        tree->root = task;
+    else if (tree->before(task, parent))
+        parent->left = task;
+    else
+        parent->right = task;
+    if (tree->first == NULL || tree->before(task, tree->first))
+        tree->first = task;
+    tree->size++;
+
+    // a red task under a red parent: recolour up, or rotate once or twice
+    while (isRed(task->parent)) {
+        parent = task->parent;
+        if (parent == parent->parent->left) {
+            uncle = parent->parent->right;
+            if (isRed(uncle)) {
+                parent->red = uncle->red = 0;
+                parent->parent->red = 1;
+                task = parent->parent;
+                continue;
+            }
+            if (task == parent->right) {
+                task = parent;
+                rotateLeft(tree, task);
+                parent = task->parent;
+            }
+            parent->red = 0;
+            parent->parent->red = 1;
+            rotateRight(tree, parent->parent);
+        }
+        else {
+            uncle = parent->parent->left;
+            if (isRed(uncle)) {
+                parent->red = uncle->red = 0;
+                parent->parent->red = 1;
+                task = parent->parent;
+                continue;
+            }
+            if (task == parent->left) {
+                task = parent;
+                rotateRight(tree, task);
+                parent = task->parent;
+            }
+            parent->red = 0;
+            parent->parent->red = 1;
+            rotateLeft(tree, parent->parent);
+        }
+    }
+    tree->root->red = 0;
+}
+
+void treeRemove(TaskTree *tree, Task *task) {
+    Task *y = task, *x, *parent, *w;
+    int removedRed = y->red;
+
+    if (task == tree->first)
+        tree->first = successor(task);
+
+    // unlink task, or its successor y moved into its place
+    if (task->left == NULL) {
+        x = task->right;
+        parent = task->parent;
+        replace(tree, task, x);
+    }
+    else if (task->right == NULL) {
+        x = task->left;
+        parent = task->parent;
+        replace(tree, task, x);
+    }
+    else {
+        y = leftmost(task->right);
+        removedRed = y->red;
+        x = y->right;
+        if (y->parent == task)
+            parent = y;
+        else {
+            parent = y->parent;
+            replace(tree, y, x);
+            y->right = task->right;
+            y->right->parent = y;
+        }
+        replace(tree, task, y);
+        y->left = task->left;
+        y->left->parent = y;
+        y->red = task->red;
+    }
+    task->left = task->right = task->parent = NULL;
+    tree->size--;
+    if (removedRed)
+        return;
+
+    // x (maybe NULL, below parent) lacks a black: push it up, or rotate it in
+    while (x != tree->root && !isRed(x)) {
+        if (x == parent->left) {
+            w = parent->right;
+            if (isRed(w)) {
+                w->red = 0;
+                parent->red = 1;
+                rotateLeft(tree, parent);
+                w = parent->right;
+            }
+            if (!isRed(w->left) && !isRed(w->right)) {
+                w->red = 1;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!isRed(w->right)) {
+                w->left->red = 0;
+                w->red = 1;
+                rotateRight(tree, w);
+                w = parent->right;
+            }
+            w->red = parent->red;
+            parent->red = 0;
+            w->right->red = 0;
+            rotateLeft(tree, parent);
+        }
+        else {
+            w = parent->left;
+            if (isRed(w)) {
+                w->red = 0;
+                parent->red = 1;
+                rotateRight(tree, parent);
+                w = parent->left;
+            }
+            if (!isRed(w->left) && !isRed(w->right)) {
+                w->red = 1;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!isRed(w->left)) {
+                w->right->red = 0;
+                w->red = 1;
+                rotateLeft(tree, w);
+                w = parent->left;
+            }
+            w->red = parent->red;
+            parent->red = 0;
+            w->left->red = 0;
+            rotateRight(tree, parent);
+        }
+        x = tree->root;
+    }
+    if (x != NULL)
+        x->red = 0;
+}
+
+Task *treeFirst(TaskTree *tree) {
+    return tree->first;
+}
+
+Task *treeLast(TaskTree *tree) {
+    Task *task = tree->root;
+
+    while (task != NULL && task->right != NULL)
+        task = task->right;
+    return task;
+}
@@ -0,0 +1,27 @@
+/**
+ * Red-black tree of tasks, in the order given by before.
+ *
+ * The tree is intrusive: the links are the left, right, parent and red
+ * fields of the tasks, so inserting and removing allocate nothing and a
+ * task is removed without searching for it. The first task is cached, so
+ * finding it is O(1); inserting and removing are O(log n).
+ */
+
+#ifndef TREE_H
+#define TREE_H
+
+#include "task.h"
+
+typedef struct {
+    Task *root;
+    Task *first;                        // leftmost, NULL when empty
+    int size;
+    int (*before)(Task *a, Task *b);    // a goes left of b
+} TaskTree;
+
+void treeInsert(TaskTree *tree, Task *task);
+void treeRemove(TaskTree *tree, Task *task);
+Task *treeFirst(TaskTree *tree);
+Task *treeLast(TaskTree *tree);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+*	Bounded lock-free queue for several producers and several consumers
+*	(Dmitry Vyukov, "Bounded MPMC queue"), a ring of power of 2 capacity.
+*
+*	Each cell has a sequence number next to its element. A producer
+*	claims the cell at enqueuePos when its sequence equals the position
+*	(the cell is free for this lap), with one compare-and-swap on
+*	enqueuePos, writes the element, then publishes it by setting the
+*	sequence to position + 1. A consumer claims the cell at dequeuePos
+*	when its sequence is position + 1, reads the element, and frees it for
+*	the next lap by setting the sequence to position + capacity. Producers
+*	and consumers thus only contend on their own index, each on its own
+*	cache line, and never wait for one another inside the queue:
+*	mpmcTryPush returns 0 when the queue is full, mpmcTryPop when it is
+*	empty, and the caller decides how to wait (see thread_pool_C_ex.c).
+*
+*	Elements are copied in and out, of any size fixed at mpmcInit.
+*	Header only; needs C11 atomics (gcc -std=c11 or later).
+*/
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MPMC_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(MPMC_CACHE_LINE) atomic_size_t enqueuePos;
+    _Alignas(MPMC_CACHE_LINE) atomic_size_t dequeuePos;
+    _Alignas(MPMC_CACHE_LINE) unsigned char* cells;     // capacity cells of stride bytes: sequence, then element
+    size_t mask;                                        // capacity - 1
+    size_t stride;
+    size_t elementSize;
+} MpmcQueue;
+
+static inline atomic_size_t* mpmcSequence(MpmcQueue* q, size_t pos) {
+    return (atomic_size_t*) (q->cells + (pos & q->mask) * q->stride);
+}
+
+static inline void* mpmcElement(MpmcQueue* q, size_t pos) {
+    return q->cells + (pos & q->mask) * q->stride + sizeof(atomic_size_t);
+}
+
+// capacity must be a power of 2; 0, or -1 when it is not or out of memory
+static inline int mpmcInit(MpmcQueue* q, size_t capacity, size_t elementSize) {
+    size_t i;
+
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        return -1;
+    q->mask = capacity - 1;
+    q->elementSize = elementSize;
+    q->stride = (sizeof(atomic_size_t) + elementSize + sizeof(atomic_size_t) - 1) / sizeof(atomic_size_t) *
+                sizeof(atomic_size_t);
+    if ((q->cells = malloc(capacity * q->stride)) == NULL)
+        return -1;
+    for (i = 0; i < capacity; i++)
+        atomic_init(mpmcSequence(q, i), i);
+    atomic_init(&q->enqueuePos, 0);
+    atomic_init(&q->dequeuePos, 0);
+    return 0;
+}
+
+static inline void mpmcDestroy(MpmcQueue* q) {
+    free(q->cells);
+    q->cells = NULL;
+}
+
+// copy element in; 0 when the queue is full
+static inline int mpmcTryPush(MpmcQueue* q, const void* element) {
+    size_t pos = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed), seq;
+    ptrdiff_t diff;
+
+    for (;;) {
+        seq = atomic_load_explicit(mpmcSequence(q, pos), memory_order_acquire);
+        diff = (ptrdiff_t) seq - (ptrdiff_t) pos;
+        if (diff == 0) {
+            // free for this lap: claim it, or retry from where another producer moved the index
+            if (atomic_compare_exchange_weak_explicit(&q->enqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return 0;   // still holds the element of the previous lap
+        else
+            pos = atomic_load_explicit(&q->enqueuePos, memory_order_relaxed);
+    }
+    memcpy(mpmcElement(q, pos), element, q->elementSize);
+    atomic_store_explicit(mpmcSequence(q, pos), pos + 1, memory_order_release);
+    return 1;
+}
+
+// copy the oldest element out; 0 when the queue is empty
+static inline int mpmcTryPop(MpmcQueue* q, void* element) {
+    size_t pos = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed), seq;
+    ptrdiff_t diff;
+
+    for (;;) {
+        seq = atomic_load_explicit(mpmcSequence(q, pos), memory_order_acquire);
+        diff = (ptrdiff_t) seq - (ptrdiff_t) (pos + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&q->dequeuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+            return 0;   // not yet written for this lap
+        else
+            pos = atomic_load_explicit(&q->dequeuePos, memory_order_relaxed);
+    }
+    memcpy(element, mpmcElement(q, pos), q->elementSize);
+    atomic_store_explicit(mpmcSequence(q, pos), pos + q->mask + 1, memory_order_release);
+    return 1;
+}
+
+// no element ready at the head, at the time of the call
+static inline int mpmcEmpty(MpmcQueue* q) {
+    size_t pos = atomic_load_explicit(&q->dequeuePos, memory_order_acquire);
+
+    return atomic_load_explicit(mpmcSequence(q, pos), memory_order_acquire) != pos + 1;
+}
+
+#endif
@@ -0,0 +1,277 @@
+// Contention benchmark of the task queue of thread_pool_C_ex.c
+// gcc -std=c11 -O2 -o mpmc_queue_bench mpmc_queue_bench.c -lpthread
+// ./mpmc_queue_bench [pairs]
+//
+// pairs (default 2000000) tasks go through each of:
+//  - mutex: the former queue of thread_pool_C_ex.c, a 256 entry array
+//    under one mutex, a condvar to wait while it is empty (and one while
+//    it is full, which it lacked), shifted down on every dequeue;
+//  - lock-free + sem: the lock-free queue (mpmc_queue.h) with the
+//    semaphores thread_pool_C_ex.c waits on;
+//  - lock-free: the queue alone, a thread yielding while it is full or empty.
+// First from 1 to 64 threads, each one enqueuing a task then dequeuing
+// one, over and over: the queue never holds more than a task per thread.
+// Then from 1 to 32 producers and as many consumers, a consumer spending
+// a little time on each task like a pool thread would, so the producers
+// fill the queue and wait on it (backpressure); the percentage of pushes
+// that found it full is printed after the rate.
+// Rates are millions of tasks per second, from the first thread to start
+// to the last one to finish.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpmc_queue.h"
+
+#define QUEUE_SIZE 256
+#define MAX_THREADS 64
+
+typedef struct Task {
+    int a, b;
+} Task;
+
+_Thread_local long fullPushes;  // pushes that found the queue full
+
+// ---- the former queue ----
+
+Task lockedQueue[QUEUE_SIZE];
+int lockedCount = 0;
+pthread_mutex_t lockedMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t lockedNotEmpty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t lockedNotFull = PTHREAD_COND_INITIALIZER;
+
+void lockedPush(Task task) {
+    pthread_mutex_lock(&lockedMutex);
+    if (lockedCount == QUEUE_SIZE)
+        fullPushes++;
+    while (lockedCount == QUEUE_SIZE)
+        pthread_cond_wait(&lockedNotFull, &lockedMutex);
+    lockedQueue[lockedCount++] = task;
+    pthread_mutex_unlock(&lockedMutex);
+    pthread_cond_signal(&lockedNotEmpty);
+}
+
+Task lockedPop(void) {
+    Task task;
+    int i;
+
+    pthread_mutex_lock(&lockedMutex);
+    while (lockedCount == 0)
+        pthread_cond_wait(&lockedNotEmpty, &lockedMutex);
+    task = lockedQueue[0];
+    for (i = 0; i < lockedCount - 1; i++)
+        lockedQueue[i] = lockedQueue[i + 1];
+    lockedCount--;
+    pthread_mutex_unlock(&lockedMutex);
+    pthread_cond_signal(&lockedNotFull);
+    return task;
+}
+
+// ---- the lock-free queue ----
+
+MpmcQueue queue;
+sem_t freeSlots, readyTasks;
+
+void semPush(Task task) {
+    if (sem_trywait(&freeSlots) != 0) {
+        fullPushes++;
+        while (sem_wait(&freeSlots) != 0)
+            ;
+    }
+    while (!mpmcTryPush(&queue, &task))
+        sched_yield();
+    sem_post(&readyTasks);
+}
+
+Task semPop(void) {
+    Task task;
+
+    while (sem_wait(&readyTasks) != 0)
+        ;
+    while (!mpmcTryPop(&queue, &task))
+        sched_yield();
+    sem_post(&freeSlots);
+    return task;
+}
+
+void spinPush(Task task) {
+    if (mpmcTryPush(&queue, &task))
+        return;
+    fullPushes++;
+    while (!mpmcTryPush(&queue, &task))
+        sched_yield();
+}
+
+Task spinPop(void) {
+    Task task;
+
+    while (!mpmcTryPop(&queue, &task))
+        sched_yield();
+    return task;
+}
+
+// ---- benchmark ----
+
+typedef struct {
+    const char* name;
+    void (*push)(Task);
+    Task (*pop)(void);
+} Variant;
+
+Variant variants[] = {
+    { "mutex", lockedPush, lockedPop },
+    { "lock-free + sem", semPush, semPop },
+    { "lock-free", spinPush, spinPop },
+};
+
+#define CONSUME_WORK 200  // iterations a consumer spends on each task
+
+pthread_barrier_t start;
+const Variant* variant;
+long tasksPerThread;
+double startTime[2 * MAX_THREADS], endTime[2 * MAX_THREADS];
+long full[2 * MAX_THREADS];
+volatile long sink;
+
+double seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// each thread times itself: main may only run again once they are done
+void* pairs(void* args) {
+    long id = (long) args, i, sum = 0;
+    Task task = { (int) id, 0 };
+
+    pthread_barrier_wait(&start);
+    startTime[id] = seconds();
+    for (i = 0; i < tasksPerThread; i++) {
+        task.b = (int) i;
+        variant->push(task);
+        task = variant->pop();
+        sum += task.a;
+    }
+    endTime[id] = seconds();
+    full[id] = fullPushes;
+    sink = sum;
+    return NULL;
+}
+
+void* producer(void* args) {
+    long id = (long) args, i;
+    Task task = { (int) id, 0 };
+
+    pthread_barrier_wait(&start);
+    startTime[id] = seconds();
+    for (i = 0; i < tasksPerThread; i++) {
+        task.b = (int) i;
+        variant->push(task);
+    }
+    endTime[id] = seconds();
+    full[id] = fullPushes;
+    return NULL;
+}
+
+void* consumer(void* args) {
+    long id = (long) args, i, sum = 0;
+    volatile long work;
+    Task task;
+    int k;
+
+    pthread_barrier_wait(&start);
+    startTime[id] = seconds();
+    for (i = 0; i < tasksPerThread; i++) {
+        task = variant->pop();
+        for (k = 0, work = task.b; k < CONSUME_WORK; k++)
+            work = work * 31 + k;
+        sum += task.a;
+    }
+    endTime[id] = seconds();
+    full[id] = 0;
+    sink = sum;
+    return NULL;
+}
+
+// tasks per second through variant v: n threads doing pairs, or n
+// producers and n consumers; *fullShare the share of pushes finding it full
+double run(int v, int n, int split, long tasks, double* fullShare) {
+    pthread_t th[2 * MAX_THREADS];
+    int i, threads = split ? 2 * n : n;
+    double first, last;
+    long fullSum = 0;
+
+    variant = &variants[v];
+    tasksPerThread = tasks / n;
+    mpmcInit(&queue, QUEUE_SIZE, sizeof(Task));
+    sem_init(&freeSlots, 0, QUEUE_SIZE);
+    sem_init(&readyTasks, 0, 0);
+    pthread_barrier_init(&start, NULL, threads);
+    for (i = 0; i < threads; i++)
+        if (pthread_create(&th[i], NULL, !split ? pairs : i < n ? producer : consumer, (void*) (long) i) != 0) {
+            perror("Failed to create the thread");
+            exit(1);
+        }
+    for (i = 0; i < threads; i++)
+        pthread_join(th[i], NULL);
+
+    first = startTime[0];
+    last = endTime[0];
+    for (i = 0; i < threads; i++) {
+        if (startTime[i] < first)
+            first = startTime[i];
+        if (endTime[i] > last)
+            last = endTime[i];
+        fullSum += full[i];
+    }
+    *fullShare = (double) fullSum / (tasksPerThread * n);
+
+    pthread_barrier_destroy(&start);
+    sem_destroy(&freeSlots);
+    sem_destroy(&readyTasks);
+    mpmcDestroy(&queue);
+    return tasksPerThread * n / (last - first);
+}
+
+int main(int argc, char* argv[]) {
+    long tasks = argc > 1 ? atol(argv[1]) : 2000000;
+    int n, v, count = sizeof(variants) / sizeof(variants[0]);
+    double rate, fullShare;
+
+    if (tasks < MAX_THREADS) {
+        fprintf(stderr, "usage: %s [pairs, at least %d]\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+    printf("%ld enqueue/dequeue pairs, millions per second, %ld CPUs\n", tasks, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%8s", "threads");
+    for (v = 0; v < count; v++)
+        printf(" %16s", variants[v].name);
+    printf("\n");
+    for (n = 1; n <= MAX_THREADS; n *= 2) {
+        printf("%8d", n);
+        for (v = 0; v < count; v++)
+            printf(" %16.2f", run(v, n, 0, tasks, &fullShare) / 1e6);
+        printf("\n");
+    }
+
+    printf("\n%ld tasks from producers to consumers, millions per second (pushes finding the queue full)\n", tasks);
+    printf("%8s", "each");
+    for (v = 0; v < count; v++)
+        printf(" %22s", variants[v].name);
+    printf("\n");
+    for (n = 1; n <= MAX_THREADS / 2; n *= 2) {
+        printf("%8d", n);
+        for (v = 0; v < count; v++) {
+            rate = run(v, n, 1, tasks, &fullShare);
+            printf(" %13.2f (%5.1f%%)", rate / 1e6, 100 * fullShare);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -1,22 +1,34 @@
 //Pool de thread em C com biblioteca pthreads
+// gcc -std=c11 -O2 -o thread_pool thread_pool_C_ex.c -lpthread
+//
+// The tasks go through a lock-free bounded queue (mpmc_queue.h). Two
+// semaphores count its free slots and its tasks: submitTask waits for a
+// free slot when the queue is full (backpressure) instead of overflowing
+// it, and idle threads sleep until there is a task. Semaphores are an
+// atomic counter that only enters the kernel to sleep or to wake a
+// sleeper, so a busy pool takes no lock at all.
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
 
+#include "mpmc_queue.h"
+
 #define THREAD_NUM 4
+#define QUEUE_SIZE 256      // a power of 2
 
 typedef struct Task {
     int a, b;
 } Task;
 
-Task taskQueue[256];
-int taskCount = 0;
-
-pthread_mutex_t mutexQueue;
-pthread_cond_t condQueue;
+MpmcQueue taskQueue;
+sem_t freeSlots;
+sem_t readyTasks;
 
 void executeTask(Task* task) {
     usleep(50000);
@@ -24,41 +36,37 @@ void executeTask(Task* task) {
     printf("The sum of %d and %d is %d\n", task->a, task->b, result);
 }
 
+// blocks while the queue is full
 void submitTask(Task task) {
-    pthread_mutex_lock(&mutexQueue);
-    taskQueue[taskCount] = task;
-    taskCount++;
-    pthread_mutex_unlock(&mutexQueue);
-    pthread_cond_signal(&condQueue);
+    while (sem_wait(&freeSlots) != 0)
+        ;
+    // a slot is ours, but the cell next in line may still be read by a slower thread
+    while (!mpmcTryPush(&taskQueue, &task))
+        sched_yield();
+    sem_post(&readyTasks);
 }
 
-// 1 2 3 4 5
-// 2 3 4 5
-
 void* startThread(void* args) {
     while (1) {
         Task task;
 
-        pthread_mutex_lock(&mutexQueue);
-        while (taskCount == 0) {
-            pthread_cond_wait(&condQueue, &mutexQueue);
-        }
-
-        task = taskQueue[0];
-        int i;
-        for (i = 0; i < taskCount - 1; i++) {
-            taskQueue[i] = taskQueue[i + 1];
-        }
-        taskCount--;
-        pthread_mutex_unlock(&mutexQueue);
+        while (sem_wait(&readyTasks) != 0)
+            ;
+        while (!mpmcTryPop(&taskQueue, &task))
+            sched_yield();
+        sem_post(&freeSlots);
         executeTask(&task);
     }
 }
 
 int main(int argc, char* argv[]) {
     pthread_t th[THREAD_NUM];
-    pthread_mutex_init(&mutexQueue, NULL);
-    pthread_cond_init(&condQueue, NULL);
+    if (mpmcInit(&taskQueue, QUEUE_SIZE, sizeof(Task)) != 0) {
+        fprintf(stderr, "Failed to create the task queue\n");
+        return 1;
+    }
+    sem_init(&freeSlots, 0, QUEUE_SIZE);
+    sem_init(&readyTasks, 0, 0);
     int i;
     for (i = 0; i < THREAD_NUM; i++) {
         if (pthread_create(&th[i], NULL, &startThread, NULL) != 0) {
@@ -80,7 +88,8 @@ int main(int argc, char* argv[]) {
             perror("Failed to join the thread");
         }
     }
-    pthread_mutex_destroy(&mutexQueue);
-    pthread_cond_destroy(&condQueue);
+    sem_destroy(&freeSlots);
+    sem_destroy(&readyTasks);
+    mpmcDestroy(&taskQueue);
     return 0;
 }
\ No newline at end of file
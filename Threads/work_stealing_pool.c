@@ -0,0 +1,450 @@
+/*
+*	Work-stealing thread pool (see work_stealing_pool.h).
+*
+*	The deque follows the C11 version of Chase & Lev by Le, Pop, Cohen and
+*	Zappa Nardelli ("Correct and efficient work-stealing for weak memory
+*	models", 2013). Arrays outgrown by a deque stay allocated until the
+*	pool is freed, since a thief may still be reading one.
+*
+*	Going to sleep and waking up pair like Dekker's algorithm: a worker
+*	counts itself among the sleepers and then looks at every queue once
+*	more, a thread pushing a task publishes it and then looks at the
+*	sleepers. With sequentially consistent fences in between, one of the
+*	two always sees the other, so a task is never left with everyone
+*	asleep, and a busy pool never touches the lock.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "mpmc_queue.h"
+#include "work_stealing_pool.h"
+
+#define DEQUE_SIZE 256          // initial capacity of a deque, a power of 2
+#define INJECT_SIZE 4096        // tasks submitted from outside waiting at once
+#define SPINS 64                // rounds of looking for work before sleeping
+
+typedef struct Task {
+    WsFunction function;
+    void* payload;
+    WsWaitGroup* group;
+    void** result;              // where to keep what the function returned, NULL for nowhere
+    _Alignas(max_align_t) unsigned char copy[];     // the payload, when it is copied
+} Task;
+
+typedef struct DequeArray {
+    long size;
+    struct DequeArray* previous;    // the array it replaced
+    _Atomic(Task*) slot[];
+} DequeArray;
+
+typedef struct {
+    _Alignas(MPMC_CACHE_LINE) atomic_long top;      // where thieves steal
+    _Alignas(MPMC_CACHE_LINE) atomic_long bottom;   // where the owner pushes and takes
+    _Atomic(DequeArray*) array;
+} Deque;
+
+typedef struct {
+    Deque deque;
+    WsPool* pool;
+    pthread_t thread;
+    int index;
+    unsigned int seed;          // to pick victims
+} Worker;
+
+struct WsPool {
+    Worker* workers;
+    int threads;
+    MpmcQueue inject;           // tasks from outside the pool
+    atomic_int sleepers;
+    pthread_mutex_t lock;       // for sleeping and shutting down
+    pthread_cond_t wake;        // workers wait there for tasks
+    pthread_cond_t quiet;       // the shutdown waits there for the workers to run out of tasks
+    atomic_int stopping;        // shutting down: no more tasks from outside
+    int exiting;                // every task is done, the workers leave
+};
+
+// the worker running on this thread, NULL outside the pools
+static _Thread_local Worker* self = NULL;
+
+// ---- deque ----
+
+static DequeArray* dequeArray(long size, DequeArray* previous) {
+    DequeArray* a = malloc(sizeof(DequeArray) + size * sizeof(Task*));
+
+    if (a != NULL) {
+        a->size = size;
+        a->previous = previous;
+    }
+    return a;
+}
+
+static int dequeInit(Deque* d) {
+    DequeArray* a = dequeArray(DEQUE_SIZE, NULL);
+
+    if (a == NULL)
+        return -1;
+    atomic_init(&d->top, 0);
+    atomic_init(&d->bottom, 0);
+    atomic_init(&d->array, a);
+    return 0;
+}
+
+static void dequeFree(Deque* d) {
+    DequeArray *a = atomic_load_explicit(&d->array, memory_order_relaxed), *previous;
+
+    for (; a != NULL; a = previous) {
+        previous = a->previous;
+        free(a);
+    }
+}
+
+// owner only: twice the size, the tasks from t to b copied over
+static DequeArray* dequeGrow(Deque* d, DequeArray* a, long t, long b) {
+    DequeArray* grown = dequeArray(2 * a->size, a);
+    long i;
+
+    if (grown == NULL)
+        return NULL;
+    for (i = t; i < b; i++)
+        atomic_store_explicit(&grown->slot[i & (grown->size - 1)],
+                              atomic_load_explicit(&a->slot[i & (a->size - 1)], memory_order_relaxed),
+                              memory_order_relaxed);
+    atomic_store_explicit(&d->array, grown, memory_order_release);
+    return grown;
+}
+
+// owner only; -1 when out of memory
+static int dequePush(Deque* d, Task* task) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    DequeArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+
+    if (b - t > a->size - 1 && (a = dequeGrow(d, a, t, b)) == NULL)
+        return -1;
+    atomic_store_explicit(&a->slot[b & (a->size - 1)], task, memory_order_relaxed);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    return 0;
+}
+
+// owner only: the newest task, NULL when empty
+static Task* dequeTake(Deque* d) {
+    long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1, t;
+    DequeArray* a = atomic_load_explicit(&d->array, memory_order_relaxed);
+    Task* task = NULL;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    if (t <= b) {
+        task = atomic_load_explicit(&a->slot[b & (a->size - 1)], memory_order_relaxed);
+        if (t == b) {
+            // the last one: whoever moves top first gets it
+            if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed))
+                task = NULL;
+            atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        }
+    }
+    else
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return task;
+}
+
+// any thread: the oldest task, NULL when empty or lost to another thief
+static Task* dequeSteal(Deque* d) {
+    long t = atomic_load_explicit(&d->top, memory_order_acquire), b;
+    DequeArray* a;
+    Task* task;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+    a = atomic_load_explicit(&d->array, memory_order_acquire);
+    task = atomic_load_explicit(&a->slot[t & (a->size - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+static int dequeEmpty(Deque* d) {
+    return atomic_load_explicit(&d->bottom, memory_order_acquire) <=
+           atomic_load_explicit(&d->top, memory_order_acquire);
+}
+
+// ---- tasks ----
+
+static void groupDone(WsWaitGroup* group) {
+    long pending = atomic_load_explicit(&group->pending, memory_order_relaxed);
+
+    // not the last one: no one to wake
+    while (pending > 1)
+        if (atomic_compare_exchange_weak(&group->pending, &pending, pending - 1))
+            return;
+    // the last one wakes the waiters under the mutex, so they cannot free the group before it is done
+    pthread_mutex_lock(&group->mutex);
+    atomic_fetch_sub(&group->pending, 1);
+    pthread_cond_broadcast(&group->done);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+static void runTask(Task* task) {
+    void* result = task->function(task->payload);
+
+    if (task->result != NULL)
+        *task->result = result;
+    if (task->group != NULL)
+        groupDone(task->group);
+    free(task);
+}
+
+// a task for worker w: its own newest, one from outside, or one stolen; NULL when none was found
+static Task* findTask(WsPool* pool, Worker* w) {
+    Task* task;
+    int i, v;
+
+    if ((task = dequeTake(&w->deque)) != NULL)
+        return task;
+    if (mpmcTryPop(&pool->inject, &task))
+        return task;
+
+    // a random victim first, then the next ones
+    w->seed = w->seed * 1103515245 + 12345;
+    v = (w->seed >> 16) % pool->threads;
+    for (i = 0; i < pool->threads; i++, v = (v + 1) % pool->threads)
+        if (v != w->index && (task = dequeSteal(&pool->workers[v].deque)) != NULL)
+            return task;
+    return NULL;
+}
+
+static int workAvailable(WsPool* pool) {
+    int i;
+
+    if (!mpmcEmpty(&pool->inject))
+        return 1;
+    for (i = 0; i < pool->threads; i++)
+        if (!dequeEmpty(&pool->workers[i].deque))
+            return 1;
+    return 0;
+}
+
+// after a task was published: wake a sleeper, if any
+static void wakeOne(WsPool* pool) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->sleepers, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// sleep until a task is pushed, unless there is one; 0 once the pool exits
+static int sleepWorker(WsPool* pool) {
+    int running;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add(&pool->sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!pool->exiting && !workAvailable(pool)) {
+        if (atomic_load(&pool->stopping) && atomic_load(&pool->sleepers) == pool->threads)
+            pthread_cond_signal(&pool->quiet);
+        pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    atomic_fetch_sub(&pool->sleepers, 1);
+    running = !pool->exiting;
+    pthread_mutex_unlock(&pool->lock);
+    return running;
+}
+
+static void* workerLoop(void* args) {
+    Worker* w = args;
+    WsPool* pool = w->pool;
+    Task* task;
+    int idle = 0;
+
+    self = w;
+    for (;;) {
+        if ((task = findTask(pool, w)) != NULL) {
+            idle = 0;
+            runTask(task);
+        }
+        else if (++idle < SPINS)
+            sched_yield();
+        else {
+            idle = 0;
+            if (!sleepWorker(pool))
+                break;
+        }
+    }
+    self = NULL;
+    return NULL;
+}
+
+// ---- pool ----
+
+// make the first started workers leave, join them and free the pool
+static void poolFree(WsPool* pool, int started) {
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->exiting = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < started; i++)
+        if (pthread_join(pool->workers[i].thread, NULL) != 0)
+            perror("Failed to join the thread");
+    for (i = 0; i < pool->threads; i++)
+        dequeFree(&pool->workers[i].deque);
+    mpmcDestroy(&pool->inject);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->quiet);
+    free(pool->workers);
+    free(pool);
+}
+
+WsPool* wsPoolCreate(int threads) {
+    WsPool* pool = aligned_alloc(MPMC_CACHE_LINE, sizeof(WsPool));
+    int i;
+
+    if (pool != NULL)
+        memset(pool, 0, sizeof(WsPool));
+    if (threads <= 0)
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0)
+        threads = 1;
+    // workers on cache lines of their own, their deques aligned
+    if (pool == NULL || (pool->workers = aligned_alloc(MPMC_CACHE_LINE, threads * sizeof(Worker))) == NULL ||
+        mpmcInit(&pool->inject, INJECT_SIZE, sizeof(Task*)) != 0) {
+        if (pool != NULL)
+            free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, threads * sizeof(Worker));
+    pool->threads = threads;
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stopping, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->quiet, NULL);
+
+    // every deque before any worker, which may steal from all of them
+    for (i = 0; i < threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pool->workers[i].seed = i + 1;
+        if (dequeInit(&pool->workers[i].deque) != 0) {
+            poolFree(pool, 0);
+            return NULL;
+        }
+    }
+    for (i = 0; i < threads; i++)
+        if (pthread_create(&pool->workers[i].thread, NULL, workerLoop, &pool->workers[i]) != 0) {
+            poolFree(pool, i);
+            return NULL;
+        }
+    return pool;
+}
+
+void wsPoolShutdown(WsPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stopping, 1);
+    while (atomic_load(&pool->sleepers) < pool->threads || workAvailable(pool))
+        pthread_cond_wait(&pool->quiet, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    poolFree(pool, pool->threads);
+}
+
+int wsPoolThreads(const WsPool* pool) {
+    return pool->threads;
+}
+
+void wsGroupInit(WsWaitGroup* group) {
+    atomic_init(&group->pending, 0);
+    pthread_mutex_init(&group->mutex, NULL);
+    pthread_cond_init(&group->done, NULL);
+}
+
+void wsGroupDestroy(WsWaitGroup* group) {
+    pthread_mutex_destroy(&group->mutex);
+    pthread_cond_destroy(&group->done);
+}
+
+static int submit(WsPool* pool, WsWaitGroup* group, void** result, WsFunction function,
+                  const void* payload, size_t size) {
+    Task* task = malloc(sizeof(Task) + size);
+
+    if (task == NULL || (self == NULL && atomic_load(&pool->stopping))) {
+        free(task);
+        return -1;
+    }
+    task->function = function;
+    task->payload = size > 0 ? memcpy(task->copy, payload, size) : (void*) payload;
+    task->group = group;
+    task->result = result;
+    if (group != NULL)
+        atomic_fetch_add(&group->pending, 1);
+
+    if (self != NULL && self->pool == pool) {
+        // spawned by a task: on the deque of its worker
+        if (dequePush(&self->deque, task) != 0) {
+            if (group != NULL)
+                atomic_fetch_sub(&group->pending, 1);
+            free(task);
+            return -1;
+        }
+    }
+    else
+        // from outside: backpressure while INJECT_SIZE tasks are waiting
+        while (!mpmcTryPush(&pool->inject, &task))
+            sched_yield();
+    wakeOne(pool);
+    return 0;
+}
+
+int wsSpawn(WsPool* pool, WsWaitGroup* group, WsFunction function, const void* payload, size_t size) {
+    return submit(pool, group, NULL, function, payload, size);
+}
+
+void wsGroupWait(WsPool* pool, WsWaitGroup* group) {
+    Worker* w = self != NULL && self->pool == pool ? self : NULL;
+    Task* task;
+
+    if (w != NULL)
+        // a worker keeps running tasks, those of the group among them
+        while (atomic_load(&group->pending) > 0) {
+            if ((task = findTask(pool, w)) != NULL)
+                runTask(task);
+            else
+                sched_yield();
+        }
+
+    pthread_mutex_lock(&group->mutex);
+    while (atomic_load(&group->pending) > 0)
+        pthread_cond_wait(&group->done, &group->mutex);
+    pthread_mutex_unlock(&group->mutex);
+}
+
+int wsAsync(WsPool* pool, WsFuture* future, WsFunction function, const void* payload, size_t size) {
+    wsGroupInit(&future->group);
+    future->result = NULL;
+    if (submit(pool, &future->group, &future->result, function, payload, size) != 0) {
+        wsGroupDestroy(&future->group);
+        return -1;
+    }
+    return 0;
+}
+
+void* wsFutureGet(WsPool* pool, WsFuture* future) {
+    wsGroupWait(pool, &future->group);
+    wsGroupDestroy(&future->group);
+    return future->result;
+}
@@ -0,0 +1,72 @@
+/*
+*	Work-stealing thread pool.
+*
+*	Every worker thread has its own deque of tasks (Chase & Lev): it
+*	pushes the tasks it spawns at the bottom and takes them back from the
+*	bottom, last in first out, without contending with anyone, while idle
+*	workers steal from the top of the deque of a random victim, the oldest
+*	and usually largest pieces of work. Tasks submitted from outside the
+*	pool go through a shared lock-free queue (mpmc_queue.h). A worker that
+*	finds nothing anywhere sleeps until a task is pushed, so long tasks on
+*	some workers never leave the others spinning or idle while work waits.
+*
+*	A task is a function and a payload. The payload is copied with the
+*	task when its size is given, or passed as is when the size is 0.
+*	Tasks may spawn tasks. Wait groups count tasks still to finish; a
+*	worker waiting on one runs other tasks meanwhile, so tasks can wait
+*	for the tasks they spawned. A future is a wait group of one task,
+*	plus what its function returned.
+*
+*	Compile with the library:
+*		gcc -std=c11 -O2 -o prog prog.c work_stealing_pool.c -lpthread
+*/
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct WsPool WsPool;
+
+// a task: what it returns is kept by its future, if it has one
+typedef void* (*WsFunction)(void* payload);
+
+typedef struct {
+    atomic_long pending;        // tasks of the group not finished yet
+    pthread_mutex_t mutex;      // to sleep while waiting from outside the pool
+    pthread_cond_t done;
+} WsWaitGroup;
+
+typedef struct {
+    WsWaitGroup group;
+    void* result;
+} WsFuture;
+
+// start threads workers, one per CPU when threads <= 0; NULL when that fails
+WsPool* wsPoolCreate(int threads);
+
+// wait for every task, spawned ones included, to finish, then stop the
+// workers and free the pool; nothing may be submitted meanwhile
+void wsPoolShutdown(WsPool* pool);
+
+int wsPoolThreads(const WsPool* pool);
+
+void wsGroupInit(WsWaitGroup* group);
+void wsGroupDestroy(WsWaitGroup* group);
+
+// run function(payload) on the pool, counted by group when not NULL;
+// 0, or -1 when out of memory or shutting down
+int wsSpawn(WsPool* pool, WsWaitGroup* group, WsFunction function, const void* payload, size_t size);
+
+// wait until every task of the group is finished; it can then be used again
+void wsGroupWait(WsPool* pool, WsWaitGroup* group);
+
+// run function(payload) on the pool, for wsFutureGet
+int wsAsync(WsPool* pool, WsFuture* future, WsFunction function, const void* payload, size_t size);
+
+// wait for the task of the future and return what it returned
+void* wsFutureGet(WsPool* pool, WsFuture* future);
+
+#endif
@@ -0,0 +1,156 @@
+// Pool de threads com roubo de tarefas (work stealing)
+// gcc -std=c11 -O2 -o work_stealing_pool work_stealing_pool_ex.c work_stealing_pool.c -lpthread
+// ./work_stealing_pool [threads]
+//
+// 1. The sums of thread_pool_C_ex.c, with skewed durations: one task in
+//    ten sleeps 50 ms like executeTask there, the others 5 ms. main only
+//    submits batches, each of which spawns its sums on the deque of its
+//    worker, where the others steal them. The workers should stay busy:
+//    the run takes about the total sleep divided by the threads.
+// 2. A divide and conquer sum of an array with futures: each task sums
+//    one half itself, the other half on the pool, then waits for it.
+// 3. The pool shuts down once every task is done, the workers are joined.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "work_stealing_pool.h"
+
+#define BATCHES 50
+#define BATCH_SIZE 10
+#define ARRAY_SIZE (1 << 24)
+#define LEAF_SIZE 4096
+
+typedef struct Task {
+    int a, b;
+} Task;
+
+WsPool* pool;
+WsWaitGroup done;
+atomic_long slept;          // microseconds
+atomic_char sums[200];      // the sums found
+
+double seconds(void) {
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+void* executeTask(void* payload) {
+    Task* task = payload;
+    unsigned int seed = task->a * 100 + task->b;
+    int sleep = rand_r(&seed) % 10 == 0 ? 50000 : 5000;
+
+    usleep(sleep);
+    atomic_fetch_add(&slept, sleep);
+    atomic_store(&sums[task->a + task->b], 1);
+    return NULL;
+}
+
+// spawn BATCH_SIZE sums from the seed of the batch
+void* spawnBatch(void* payload) {
+    unsigned int seed = *(unsigned int*) payload;
+    Task t;
+    int i;
+
+    for (i = 0; i < BATCH_SIZE; i++) {
+        t.a = rand_r(&seed) % 100;
+        t.b = rand_r(&seed) % 100;
+        if (wsSpawn(pool, &done, executeTask, &t, sizeof(t)) != 0) {
+            fprintf(stderr, "Failed to spawn a task\n");
+            exit(1);
+        }
+    }
+    return NULL;
+}
+
+// ---- sum of an array ----
+
+typedef struct {
+    const int* values;
+    long n;
+} Range;
+
+void* sumRange(void* payload) {
+    Range* range = payload;
+    Range half = { range->values, range->n / 2 };
+    WsFuture future;
+    long sum = 0, i;
+
+    if (range->n <= LEAF_SIZE) {
+        for (i = 0; i < range->n; i++)
+            sum += range->values[i];
+        return (void*) sum;
+    }
+    // the first half on the pool, for another worker to steal, the second one here
+    if (wsAsync(pool, &future, sumRange, &half, sizeof(half)) != 0) {
+        fprintf(stderr, "Failed to spawn a task\n");
+        exit(1);
+    }
+    half.values += half.n;
+    half.n = range->n - half.n;
+    sum = (long) sumRange(&half);
+    return (void*) (sum + (long) wsFutureGet(pool, &future));
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4, i, found = 0;
+    unsigned int seed;
+    long serial = 0, sum;
+    int* values;
+    Range all;
+    WsFuture total;
+    double t0;
+
+    if ((pool = wsPoolCreate(threads)) == NULL) {
+        fprintf(stderr, "Failed to create the pool\n");
+        return 1;
+    }
+    threads = wsPoolThreads(pool);
+
+    wsGroupInit(&done);
+    srand(time(NULL));
+    t0 = seconds();
+    for (i = 0; i < BATCHES; i++) {
+        seed = rand();
+        if (wsSpawn(pool, &done, spawnBatch, &seed, sizeof(seed)) != 0) {
+            fprintf(stderr, "Failed to spawn a task\n");
+            return 1;
+        }
+    }
+    wsGroupWait(pool, &done);
+    t0 = seconds() - t0;
+    for (i = 0; i < 200; i++)
+        found += atomic_load(&sums[i]);
+    printf("%d tasks on %d threads, %d different sums: %.3f s, %.3f s of sleep, busy %.0f%%\n",
+           BATCHES * BATCH_SIZE, threads, found, t0, atomic_load(&slept) / 1e6,
+           100 * atomic_load(&slept) / 1e6 / threads / t0);
+    wsGroupDestroy(&done);
+
+    values = malloc(ARRAY_SIZE * sizeof(int));
+    if (values == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < ARRAY_SIZE; i++) {
+        values[i] = rand() % 1000;
+        serial += values[i];
+    }
+    all.values = values;
+    all.n = ARRAY_SIZE;
+    t0 = seconds();
+    if (wsAsync(pool, &total, sumRange, &all, sizeof(all)) != 0) {
+        fprintf(stderr, "Failed to spawn a task\n");
+        return 1;
+    }
+    sum = (long) wsFutureGet(pool, &total);
+    t0 = seconds() - t0;
+    printf("sum of %d values in tasks of %d: %ld (serial %ld), %.3f s\n", ARRAY_SIZE, LEAF_SIZE, sum, serial, t0);
+    free(values);
+
+    wsPoolShutdown(pool);
+    return 0;
+}